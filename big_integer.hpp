@@ -0,0 +1,302 @@
+#pragma once
+#ifndef BIG_INTEGER_HPP
+#define BIG_INTEGER_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+// The arbitrary-precision integers of BigArithmetic (see parser_core.hpp).
+//
+// Everything that only happens once a value has outgrown int64_t is kept out
+// of line, so that the grammar only inlines the int64_t fast path.
+
+// Storage for the limbs of big integers, all released together when the arena
+// is destroyed. Nothing is allocated until the first big integer.
+class BigArena {
+public:
+    uint32_t* allocate(size_t count) {
+        if (count > available) {
+            const size_t chunk_limbs = 4096;
+            size_t size = std::max(count, chunk_limbs);
+            chunks.emplace_back(new uint32_t[size]);
+            next = chunks.back().get();
+            available = size;
+        }
+        uint32_t* limbs = next;
+        next += count;
+        available -= count;
+        return limbs;
+    }
+
+private:
+    std::vector<std::unique_ptr<uint32_t[]>> chunks;
+    uint32_t* next = nullptr;
+    size_t available = 0;
+};
+
+// An integer of any size. While it fits in an int64_t, it is held in small
+// and limbs is null. Otherwise its magnitude is the span [limbs, limbs + size)
+// of 32-bit limbs, least significant first, which lives in a BigArena.
+struct BigValue {
+    int64_t small;
+    const uint32_t* limbs;
+    uint32_t size;
+    bool negative;
+
+    bool is_small() const { return limbs == nullptr; }
+};
+
+namespace big_integer_detail {
+
+struct Magnitude {
+    const uint32_t* limbs;
+    uint32_t size;
+    uint32_t inline_limbs[2];  // for small values
+
+    explicit Magnitude(const BigValue& v) {
+        if (!v.is_small()) {
+            limbs = v.limbs;
+            size = v.size;
+            return;
+        }
+        uint64_t m = v.small < 0 ? 0 - static_cast<uint64_t>(v.small) : static_cast<uint64_t>(v.small);
+        inline_limbs[0] = static_cast<uint32_t>(m);
+        inline_limbs[1] = static_cast<uint32_t>(m >> 32);
+        limbs = inline_limbs;
+        size = inline_limbs[1] ? 2 : inline_limbs[0] ? 1 : 0;
+    }
+
+    Magnitude(const Magnitude&) = delete;
+};
+
+inline bool is_negative(const BigValue& v) {
+    return v.is_small() ? v.small < 0 : v.negative;
+}
+
+// Trims leading zero limbs, and moves the value back into an int64_t if it
+// fits, so that the fast path applies again.
+inline BigValue make_value(bool negative, const uint32_t* limbs, uint32_t size) {
+    while (size > 0 && limbs[size - 1] == 0) {
+        --size;
+    }
+    if (size <= 2) {
+        uint64_t m = size == 0 ? 0 : size == 1 ? limbs[0] : limbs[0] | static_cast<uint64_t>(limbs[1]) << 32;
+        if (!negative && m <= static_cast<uint64_t>(INT64_MAX)) {
+            return BigValue{static_cast<int64_t>(m), nullptr, 0, false};
+        }
+        if (negative && m <= static_cast<uint64_t>(INT64_MAX) + 1) {
+            return BigValue{static_cast<int64_t>(0 - m), nullptr, 0, false};
+        }
+    }
+    return BigValue{0, limbs, size, negative};
+}
+
+inline int compare_magnitudes(const uint32_t* a, uint32_t an, const uint32_t* b, uint32_t bn) {
+    if (an != bn) {
+        return an < bn ? -1 : 1;
+    }
+    for (uint32_t i = an; i-- > 0;) {
+        if (a[i] != b[i]) {
+            return a[i] < b[i] ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+// out has max(an, bn) + 1 limbs.
+inline void add_magnitudes(uint32_t* out, const uint32_t* a, uint32_t an, const uint32_t* b, uint32_t bn) {
+    if (an < bn) {
+        std::swap(a, b);
+        std::swap(an, bn);
+    }
+    uint64_t carry = 0;
+    for (uint32_t i = 0; i < an; ++i) {
+        carry += static_cast<uint64_t>(a[i]) + (i < bn ? b[i] : 0);
+        out[i] = static_cast<uint32_t>(carry);
+        carry >>= 32;
+    }
+    out[an] = static_cast<uint32_t>(carry);
+}
+
+// a >= b; out has an limbs.
+inline void subtract_magnitudes(uint32_t* out, const uint32_t* a, uint32_t an, const uint32_t* b, uint32_t bn) {
+    uint64_t borrow = 0;
+    for (uint32_t i = 0; i < an; ++i) {
+        uint64_t d = static_cast<uint64_t>(a[i]) - (i < bn ? b[i] : 0) - borrow;
+        out[i] = static_cast<uint32_t>(d);
+        borrow = d >> 63;
+    }
+}
+
+// out has an + bn limbs.
+inline void multiply_magnitudes(uint32_t* out, const uint32_t* a, uint32_t an, const uint32_t* b, uint32_t bn) {
+    std::fill(out, out + an + bn, 0u);
+    for (uint32_t i = 0; i < an; ++i) {
+        uint64_t carry = 0;
+        for (uint32_t j = 0; j < bn; ++j) {
+            carry += static_cast<uint64_t>(a[i]) * b[j] + out[i + j];
+            out[i + j] = static_cast<uint32_t>(carry);
+            carry >>= 32;
+        }
+        out[i + bn] = static_cast<uint32_t>(carry);
+    }
+}
+
+// Truncating division of a by b, with an >= bn >= 1 and b without leading zero
+// limbs; q has an - bn + 1 limbs. Knuth's algorithm D (TAOCP 4.3.1), as in
+// Hacker's Delight.
+inline void divide_magnitudes(uint32_t* q, const uint32_t* a, uint32_t an, const uint32_t* b, uint32_t bn) {
+    if (bn == 1) {
+        uint64_t r = 0;
+        for (uint32_t i = an; i-- > 0;) {
+            uint64_t cur = r << 32 | a[i];
+            q[i] = static_cast<uint32_t>(cur / b[0]);
+            r = cur % b[0];
+        }
+        return;
+    }
+
+    // Normalise so that the top limb of the divisor has its high bit set.
+    unsigned s = static_cast<unsigned>(__builtin_clz(b[bn - 1]));
+    std::vector<uint32_t> vn(bn);
+    std::vector<uint32_t> un(an + 1);
+    for (uint32_t i = bn - 1; i > 0; --i) {
+        vn[i] = static_cast<uint32_t>(b[i] << s | static_cast<uint64_t>(b[i - 1]) >> (32 - s));
+    }
+    vn[0] = b[0] << s;
+    un[an] = static_cast<uint32_t>(static_cast<uint64_t>(a[an - 1]) >> (32 - s));
+    for (uint32_t i = an - 1; i > 0; --i) {
+        un[i] = static_cast<uint32_t>(a[i] << s | static_cast<uint64_t>(a[i - 1]) >> (32 - s));
+    }
+    un[0] = a[0] << s;
+
+    const uint64_t base = uint64_t{1} << 32;
+    for (uint32_t j = an - bn + 1; j-- > 0;) {
+        uint64_t num = static_cast<uint64_t>(un[j + bn]) << 32 | un[j + bn - 1];
+        uint64_t qhat = num / vn[bn - 1];
+        uint64_t rhat = num % vn[bn - 1];
+        while (qhat >= base || qhat * vn[bn - 2] > (rhat << 32 | un[j + bn - 2])) {
+            --qhat;
+            rhat += vn[bn - 1];
+            if (rhat >= base) {
+                break;
+            }
+        }
+
+        // Multiply and subtract; add back if qhat was still one too large.
+        int64_t k = 0;
+        int64_t t = 0;
+        for (uint32_t i = 0; i < bn; ++i) {
+            uint64_t p = qhat * vn[i];
+            t = static_cast<int64_t>(un[i + j]) - k - static_cast<int64_t>(p & 0xFFFFFFFF);
+            un[i + j] = static_cast<uint32_t>(t);
+            k = static_cast<int64_t>(p >> 32) - (t >> 32);
+        }
+        t = static_cast<int64_t>(un[j + bn]) - k;
+        un[j + bn] = static_cast<uint32_t>(t);
+
+        q[j] = static_cast<uint32_t>(qhat);
+        if (t < 0) {
+            --q[j];
+            uint64_t carry = 0;
+            for (uint32_t i = 0; i < bn; ++i) {
+                carry += static_cast<uint64_t>(un[i + j]) + vn[i];
+                un[i + j] = static_cast<uint32_t>(carry);
+                carry >>= 32;
+            }
+            un[j + bn] = static_cast<uint32_t>(un[j + bn] + carry);
+        }
+    }
+}
+
+} // namespace big_integer_detail
+
+// a + b, or a - b if subtract is set.
+__attribute__((noinline))
+inline BigValue big_add(BigArena& arena, const BigValue& a, const BigValue& b, bool subtract) {
+    using namespace big_integer_detail;
+    Magnitude ma{a};
+    Magnitude mb{b};
+    bool a_negative = is_negative(a);
+    bool b_negative = is_negative(b) != subtract;
+    if (a_negative == b_negative) {
+        uint32_t size = std::max(ma.size, mb.size) + 1;
+        uint32_t* out = arena.allocate(size);
+        add_magnitudes(out, ma.limbs, ma.size, mb.limbs, mb.size);
+        return make_value(a_negative, out, size);
+    }
+    if (compare_magnitudes(ma.limbs, ma.size, mb.limbs, mb.size) >= 0) {
+        uint32_t* out = arena.allocate(ma.size);
+        subtract_magnitudes(out, ma.limbs, ma.size, mb.limbs, mb.size);
+        return make_value(a_negative, out, ma.size);
+    } else {
+        uint32_t* out = arena.allocate(mb.size);
+        subtract_magnitudes(out, mb.limbs, mb.size, ma.limbs, ma.size);
+        return make_value(b_negative, out, mb.size);
+    }
+}
+
+__attribute__((noinline))
+inline BigValue big_multiply(BigArena& arena, const BigValue& a, const BigValue& b) {
+    using namespace big_integer_detail;
+    Magnitude ma{a};
+    Magnitude mb{b};
+    uint32_t size = ma.size + mb.size;
+    uint32_t* out = arena.allocate(size);
+    multiply_magnitudes(out, ma.limbs, ma.size, mb.limbs, mb.size);
+    return make_value(is_negative(a) != is_negative(b), out, size);
+}
+
+// Truncates towards zero, like int64_t division. b must not be zero.
+__attribute__((noinline))
+inline BigValue big_divide(BigArena& arena, const BigValue& a, const BigValue& b) {
+    using namespace big_integer_detail;
+    Magnitude ma{a};
+    Magnitude mb{b};
+    if (ma.size < mb.size) {
+        return BigValue{0, nullptr, 0, false};
+    }
+    uint32_t size = ma.size - mb.size + 1;
+    uint32_t* out = arena.allocate(size);
+    divide_magnitudes(out, ma.limbs, ma.size, mb.limbs, mb.size);
+    return make_value(is_negative(a) != is_negative(b), out, size);
+}
+
+// The value in decimal, with a leading '-' if it is negative.
+inline std::string to_decimal(const BigValue& v) {
+    if (v.is_small()) {
+        return std::to_string(v.small);
+    }
+
+    // Peel off 9 decimal digits at a time, least significant first.
+    std::vector<uint32_t> limbs(v.limbs, v.limbs + v.size);
+    std::vector<uint32_t> groups;
+    while (!limbs.empty()) {
+        uint64_t r = 0;
+        for (size_t i = limbs.size(); i-- > 0;) {
+            uint64_t cur = r << 32 | limbs[i];
+            limbs[i] = static_cast<uint32_t>(cur / 1000000000);
+            r = cur % 1000000000;
+        }
+        groups.push_back(static_cast<uint32_t>(r));
+        while (!limbs.empty() && limbs.back() == 0) {
+            limbs.pop_back();
+        }
+    }
+
+    std::string out = v.negative ? "-" : "";
+    out += std::to_string(groups.back());
+    for (size_t i = groups.size() - 1; i-- > 0;) {
+        std::string group = std::to_string(groups[i]);
+        out.append(9 - group.size(), '0');
+        out += group;
+    }
+    return out;
+}
+
+#endif // BIG_INTEGER_HPP
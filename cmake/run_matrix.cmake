@@ -0,0 +1,43 @@
+# Runs the benchmark binaries listed in the matrix.txt files given in
+# MATRIX_FILES (separated by '|'), each with the arguments in RUNNER_ARGS
+# (likewise separated by '|'), and merges their output into results.csv and
+# results.jsonl in the current directory. Each matrix.txt line reads
+# "variant;binary;engine-object;...".
+
+string(REPLACE "|" ";" matrix_files "${MATRIX_FILES}")
+string(REPLACE "|" ";" runner_args "${RUNNER_ARGS}")
+
+file(WRITE results.csv "compiler;benchmark;µs\n")
+file(REMOVE results.jsonl sizes.csv functions.csv)
+
+foreach(matrix_file ${matrix_files})
+    if(NOT EXISTS ${matrix_file})
+        message(WARNING "${matrix_file} does not exist, skipping")
+        continue()
+    endif()
+    file(STRINGS ${matrix_file} lines)
+    foreach(line ${lines})
+        set(entry ${line})
+        list(GET entry 0 variant)
+        list(GET entry 1 binary)
+        list(SUBLIST entry 2 -1 objects)
+
+        execute_process(COMMAND ${binary} ${ITERATIONS} ${REPETITIONS} ${runner_args} RESULT_VARIABLE status)
+        if(NOT status EQUAL 0)
+            message(FATAL_ERROR "${binary} failed: ${status}")
+        endif()
+        if(COLD)
+            execute_process(COMMAND ${binary} ${ITERATIONS} ${REPETITIONS} ${runner_args} --cold RESULT_VARIABLE status)
+            if(NOT status EQUAL 0)
+                message(FATAL_ERROR "${binary} --cold failed: ${status}")
+            endif()
+        endif()
+        execute_process(COMMAND ${SCRIPTS_DIR}/size_report.sh ${variant} ${binary} ${objects}
+            RESULT_VARIABLE status)
+        if(NOT status EQUAL 0)
+            message(FATAL_ERROR "size report for ${binary} failed: ${status}")
+        endif()
+    endforeach()
+endforeach()
+
+execute_process(COMMAND ${SCRIPTS_DIR}/merge_sizes.sh results.csv sizes.csv)
@@ -0,0 +1,564 @@
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>) && defined(__NR_io_uring_setup)
+#include <linux/io_uring.h>
+#define INGEST_IO_URING 1
+#endif
+#endif
+
+#include "parser.hpp"
+
+// parser-ingest: evaluates a corpus of programs, one per line, straight from
+// disk. The file is read in chunks with io_uring: a fixed set of buffers,
+// registered with the kernel up front, each with a read in flight, so the
+// disk works ahead while the engine parses. Without io_uring (an old kernel,
+// a seccomp filter, or --pread) the same chunks are read with pread.
+//
+// Chunks are handed over in file order. Programs that lie within a chunk are
+// evaluated right there in the buffer; one that straddles a chunk boundary is
+// reassembled first.
+//
+// The time the main thread spends in the engine is measured separately from
+// the rest of its CPU time, which goes to I/O: submitting and reaping reads,
+// or pread itself. With io_uring, part of the reading may also happen in
+// kernel workers, which only shows in the CPU time of the whole process.
+
+// Stands in for "no error", since engines only store an ErrorKind on errors.
+const ErrorKind no_error = static_cast<ErrorKind>(-1);
+
+uint64_t get_monotonic_time_ns() {
+    timespec t;
+    ::clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1000000000ull + t.tv_nsec;
+}
+
+uint64_t get_thread_time_ns() {
+    timespec t;
+    ::clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t);
+    return t.tv_sec * 1000000000ull + t.tv_nsec;
+}
+
+uint64_t get_process_time_ns() {
+    rusage u;
+    ::getrusage(RUSAGE_SELF, &u);
+    return (u.ru_utime.tv_sec + u.ru_stime.tv_sec) * 1000000000ull + (u.ru_utime.tv_usec + u.ru_stime.tv_usec) * 1000ull;
+}
+
+using ChunkConsumer = std::function<void(const char* data, size_t size)>;
+
+// Reads a whole file in chunks of up to chunk_size bytes, in order.
+struct ChunkReader {
+    virtual ~ChunkReader() {}
+    virtual const char* name() const = 0;
+
+    // Returns false, with errno set, if a read fails.
+    virtual bool read(int fd, uint64_t file_size, const ChunkConsumer& consume) = 0;
+};
+
+struct AlignedBuffer {
+    char* data;
+
+    explicit AlignedBuffer(size_t size) : data(nullptr) {
+        void* p = nullptr;
+        if (::posix_memalign(&p, 4096, size) != 0) {
+            throw std::bad_alloc{};
+        }
+        data = static_cast<char*>(p);
+    }
+    ~AlignedBuffer() { std::free(data); }
+    AlignedBuffer(const AlignedBuffer&) = delete;
+    AlignedBuffer& operator=(const AlignedBuffer&) = delete;
+};
+
+class PreadReader : public ChunkReader {
+public:
+    explicit PreadReader(size_t chunk_size) : chunk_size(chunk_size), buffer(chunk_size) {}
+
+    const char* name() const override { return "pread"; }
+
+    bool read(int fd, uint64_t file_size, const ChunkConsumer& consume) override {
+        for (uint64_t offset = 0; offset < file_size;) {
+            ssize_t n = ::pread(fd, buffer.data, chunk_size, static_cast<off_t>(offset));
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n < 0) {
+                return false;
+            }
+            if (n == 0) {
+                break;  // the file got shorter
+            }
+            consume(buffer.data, static_cast<size_t>(n));
+            offset += static_cast<uint64_t>(n);
+        }
+        return true;
+    }
+
+private:
+    size_t chunk_size;
+    AlignedBuffer buffer;
+};
+
+#if defined(INGEST_IO_URING)
+// The io_uring system calls and ring layout, used directly rather than
+// through liburing, which the build doesn't depend on.
+class IoUringReader : public ChunkReader {
+public:
+    IoUringReader(size_t chunk_size, unsigned depth) : chunk_size(chunk_size) {
+        for (unsigned i = 0; i < depth; ++i) {
+            slots.emplace_back(new Slot{chunk_size});
+        }
+    }
+
+    ~IoUringReader() {
+        if (sq_ring != MAP_FAILED) {
+            ::munmap(sq_ring, sq_ring_size);
+        }
+        if (cq_ring != MAP_FAILED && cq_ring != sq_ring) {
+            ::munmap(cq_ring, cq_ring_size);
+        }
+        if (sqes != MAP_FAILED) {
+            ::munmap(sqes, sqes_size);
+        }
+        if (ring >= 0) {
+            ::close(ring);
+        }
+    }
+
+    // Sets up the ring and registers the buffers. Fails if the kernel
+    // doesn't have io_uring or doesn't allow it; registering the buffers may
+    // fail on its own (RLIMIT_MEMLOCK), in which case reads go to unregistered
+    // buffers.
+    bool setup() {
+        io_uring_params params{};
+        ring = static_cast<int>(::syscall(__NR_io_uring_setup, static_cast<unsigned>(slots.size()), &params));
+        if (ring < 0) {
+            return false;
+        }
+
+        sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+        cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (single_mmap) {
+            sq_ring_size = cq_ring_size = std::max(sq_ring_size, cq_ring_size);
+        }
+        sq_ring = ::mmap(nullptr, sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_SQ_RING);
+        if (sq_ring == MAP_FAILED) {
+            return false;
+        }
+        cq_ring = single_mmap ? sq_ring
+                              : ::mmap(nullptr, cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring,
+                                       IORING_OFF_CQ_RING);
+        sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+        sqes = ::mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_SQES);
+        if (cq_ring == MAP_FAILED || sqes == MAP_FAILED) {
+            return false;
+        }
+
+        char* sq = static_cast<char*>(sq_ring);
+        char* cq = static_cast<char*>(cq_ring);
+        sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sq_mask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cq_mask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+        std::vector<iovec> buffers;
+        for (const std::unique_ptr<Slot>& slot : slots) {
+            buffers.push_back(iovec{slot->buffer.data, chunk_size});
+        }
+        registered = ::syscall(__NR_io_uring_register, ring, IORING_REGISTER_BUFFERS, buffers.data(),
+                               static_cast<unsigned>(buffers.size())) == 0;
+        return true;
+    }
+
+    const char* name() const override { return registered ? "io_uring" : "io_uring-unregistered"; }
+
+    // Every slot reads one chunk at a time. The slot holding the next chunk
+    // in file order is consumed as soon as it is complete, then starts on the
+    // next chunk nobody is reading yet.
+    bool read(int fd, uint64_t file_size, const ChunkConsumer& consume) override {
+        uint64_t next_offset = 0;   // of the next chunk to start reading
+        uint64_t next_consume = 0;  // of the next chunk to hand over
+        unsigned in_flight = 0;
+        for (unsigned i = 0; i < slots.size() && next_offset < file_size; ++i) {
+            start(*slots[i], i, fd, next_offset, file_size);
+            next_offset += slots[i]->expected;
+            ++in_flight;
+        }
+
+        while (in_flight > 0) {
+            if (!submit_and_wait()) {
+                return false;
+            }
+            unsigned head = *cq_head;
+            unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+            for (; head != tail; ++head) {
+                const io_uring_cqe& cqe = cqes[head & cq_mask];
+                Slot& slot = *slots[cqe.user_data];
+                if (cqe.res < 0) {
+                    errno = -cqe.res;
+                    return false;
+                }
+                slot.filled += static_cast<size_t>(cqe.res);
+                if (cqe.res == 0) {
+                    slot.expected = slot.filled;  // the file got shorter
+                }
+                if (slot.filled < slot.expected) {
+                    queue_read(slot, static_cast<unsigned>(cqe.user_data), fd);  // a short read: the rest
+                } else {
+                    slot.done = true;
+                    --in_flight;
+                }
+            }
+            __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+
+            // Hand over every chunk that is complete, in order.
+            for (bool progress = true; progress;) {
+                progress = false;
+                for (unsigned i = 0; i < slots.size(); ++i) {
+                    Slot& slot = *slots[i];
+                    if (!slot.done || slot.offset != next_consume) {
+                        continue;
+                    }
+                    consume(slot.buffer.data, slot.filled);
+                    next_consume += slot.filled;
+                    slot.done = false;
+                    if (slot.filled < chunk_size && next_consume < file_size) {
+                        next_offset = next_consume;  // cut short at the end of the file
+                    }
+                    if (next_offset < file_size) {
+                        start(slot, i, fd, next_offset, file_size);
+                        next_offset += slot.expected;
+                        ++in_flight;
+                    }
+                    progress = true;
+                }
+            }
+        }
+        return true;
+    }
+
+private:
+    struct Slot {
+        explicit Slot(size_t chunk_size) : buffer(chunk_size) {}
+
+        AlignedBuffer buffer;
+        uint64_t offset = 0;
+        size_t expected = 0;
+        size_t filled = 0;
+        bool done = false;
+    };
+
+    size_t chunk_size;
+    std::vector<std::unique_ptr<Slot>> slots;
+    int ring = -1;
+    bool registered = false;
+    unsigned to_submit = 0;
+
+    void* sq_ring = MAP_FAILED;
+    void* cq_ring = MAP_FAILED;
+    void* sqes = MAP_FAILED;
+    size_t sq_ring_size = 0;
+    size_t cq_ring_size = 0;
+    size_t sqes_size = 0;
+    unsigned* sq_tail = nullptr;
+    unsigned sq_mask = 0;
+    unsigned* sq_array = nullptr;
+    unsigned* cq_head = nullptr;
+    unsigned* cq_tail = nullptr;
+    unsigned cq_mask = 0;
+    io_uring_cqe* cqes = nullptr;
+
+    void start(Slot& slot, unsigned index, int fd, uint64_t offset, uint64_t file_size) {
+        slot.offset = offset;
+        slot.expected = static_cast<size_t>(std::min<uint64_t>(chunk_size, file_size - offset));
+        slot.filled = 0;
+        queue_read(slot, index, fd);
+    }
+
+    void queue_read(const Slot& slot, unsigned index, int fd) {
+        unsigned tail = *sq_tail;
+        unsigned entry = tail & sq_mask;
+        io_uring_sqe& sqe = static_cast<io_uring_sqe*>(sqes)[entry];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = registered ? IORING_OP_READ_FIXED : IORING_OP_READ;
+        sqe.fd = fd;
+        sqe.off = slot.offset + slot.filled;
+        sqe.addr = reinterpret_cast<uint64_t>(slot.buffer.data + slot.filled);
+        // Up to the end of the buffer rather than of the file, since O_DIRECT
+        // wants whole blocks.
+        sqe.len = static_cast<uint32_t>(chunk_size - slot.filled);
+        sqe.buf_index = static_cast<uint16_t>(registered ? index : 0);
+        sqe.user_data = index;
+        sq_array[entry] = entry;
+        __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+        ++to_submit;
+    }
+
+    // Submits the queued reads and waits for at least one completion.
+    bool submit_and_wait() {
+        for (;;) {
+            long n = ::syscall(__NR_io_uring_enter, ring, to_submit, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+            if (n >= 0) {
+                to_submit -= static_cast<unsigned>(n);
+                return true;
+            }
+            if (errno != EINTR) {
+                return false;
+            }
+        }
+    }
+};
+#endif
+
+// Splits the chunks of a corpus into lines, each a program. Blank lines are
+// skipped.
+class ProgramSplitter {
+public:
+    using ProgramConsumer = std::function<void(const char* program, size_t length)>;
+
+    explicit ProgramSplitter(ProgramConsumer consume) : consume(std::move(consume)) {}
+
+    void feed(const char* data, size_t size) {
+        const char* end = data + size;
+        const char* p = data;
+        if (!carry.empty() && size > 0) {
+            // Counted once, however many chunks the program spans.
+            reassembled += !joined;
+            joined = true;
+            const char* newline = static_cast<const char*>(std::memchr(p, '\n', size));
+            if (!newline) {
+                carry.append(p, size);
+                return;
+            }
+            carry.append(p, newline);
+            emit(carry.data(), carry.size());
+            carry.clear();
+            p = newline + 1;
+        }
+        while (const char* newline = static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(end - p)))) {
+            emit(p, static_cast<size_t>(newline - p));
+            p = newline + 1;
+        }
+        carry.assign(p, end);
+        joined = false;
+    }
+
+    void finish() {
+        emit(carry.data(), carry.size());
+        carry.clear();
+        joined = false;
+    }
+
+    size_t reassembled = 0;  // programs that straddled a chunk boundary
+
+private:
+    ProgramConsumer consume;
+    std::string carry;
+    bool joined = false;  // carry already has bytes of a later chunk
+
+    void emit(const char* program, size_t length) {
+        if (length > 0) {
+            consume(program, length);
+        }
+    }
+};
+
+// Writes about megabytes of programs like input.ok and input.err, so that
+// there is a corpus to measure with.
+bool generate_corpus(const char* path, size_t megabytes) {
+    std::ifstream ok{"input.ok"};
+    std::ifstream err{"input.err"};
+    std::string ok_program;
+    std::string err_program;
+    std::getline(ok, ok_program);
+    std::getline(err, err_program);
+    if (ok_program.empty() || err_program.empty()) {
+        std::cerr << "input.ok and input.err are needed to generate a corpus.\n";
+        return false;
+    }
+
+    std::ofstream out{path, std::ios_base::binary | std::ios_base::trunc};
+    std::string block;
+    for (size_t i = 0; i < 1000; ++i) {
+        block += i % 100 == 99 ? err_program : ok_program;
+        block += '\n';
+    }
+    for (size_t written = 0; written < megabytes << 20; written += block.size()) {
+        out.write(block.data(), static_cast<std::streamsize>(block.size()));
+    }
+    return static_cast<bool>(out);
+}
+
+std::unique_ptr<IParser> make_engine(const std::string& name) {
+    if (name == "exceptions") {
+        return make_parser_with_exceptions();
+    } else if (name == "results") {
+        return make_parser_with_results();
+    } else if (name == "validation") {
+        return make_parser_with_validation();
+#if defined(PARSER_COROUTINES)
+    } else if (name == "coroutines") {
+        return make_parser_with_coroutines();
+#endif
+    }
+    return nullptr;
+}
+
+bool parse_number(const char* arg, size_t& out) {
+    std::stringstream ss;
+    ss << arg;
+    return static_cast<bool>(ss >> out) && out > 0;
+}
+
+int main(int argc, char const *argv[])
+{
+    const char* path = nullptr;
+    std::string engine_name = "results";
+    size_t chunk_kb = 1024;
+    size_t depth = 8;
+    size_t generate_mb = 0;
+    bool force_pread = false;
+    bool direct = false;
+    bool usage = false;
+    for (int i = 1; i < argc && !usage; ++i) {
+        bool has_value = i + 1 < argc;
+        if (std::strcmp(argv[i], "--engine") == 0 && has_value) {
+            engine_name = argv[++i];
+        } else if (std::strcmp(argv[i], "--chunk-kb") == 0 && has_value) {
+            usage = !parse_number(argv[++i], chunk_kb) || chunk_kb % 4 != 0;
+        } else if (std::strcmp(argv[i], "--depth") == 0 && has_value) {
+            usage = !parse_number(argv[++i], depth) || depth > 4096;
+        } else if (std::strcmp(argv[i], "--generate-mb") == 0 && has_value) {
+            usage = !parse_number(argv[++i], generate_mb);
+        } else if (std::strcmp(argv[i], "--pread") == 0) {
+            force_pread = true;
+        } else if (std::strcmp(argv[i], "--direct") == 0) {
+            direct = true;
+        } else if (argv[i][0] != '-' && !path) {
+            path = argv[i];
+        } else {
+            usage = true;
+        }
+    }
+    if (usage || !path) {
+        std::cerr << "Usage: " << argv[0] << " CORPUS [--engine exceptions|results|validation|coroutines] [--chunk-kb N]"
+                  << " [--depth N] [--pread] [--direct]\n"
+                  << "       " << argv[0] << " CORPUS --generate-mb N\n";
+        return 1;
+    }
+    if (generate_mb > 0) {
+        return generate_corpus(path, generate_mb) ? 0 : 1;
+    }
+
+    std::unique_ptr<IParser> engine = make_engine(engine_name);
+    if (!engine) {
+        std::cerr << "Unknown engine: " << engine_name << '\n';
+        return 1;
+    }
+
+    // O_DIRECT bypasses the page cache, so that a corpus read a second time
+    // still comes from the disk.
+    int fd = ::open(path, O_RDONLY | O_CLOEXEC | (direct ? O_DIRECT : 0));
+    struct stat st;
+    if (fd < 0 || ::fstat(fd, &st) != 0) {
+        std::perror(path);
+        return 1;
+    }
+    uint64_t file_size = static_cast<uint64_t>(st.st_size);
+
+    size_t chunk_size = chunk_kb * 1024;
+    std::unique_ptr<ChunkReader> reader;
+#if defined(INGEST_IO_URING)
+    if (!force_pread) {
+        std::unique_ptr<IoUringReader> uring{new IoUringReader{chunk_size, static_cast<unsigned>(depth)}};
+        if (uring->setup()) {
+            reader = std::move(uring);
+        }
+    }
+#endif
+    if (!reader) {
+        reader.reset(new PreadReader{chunk_size});
+    }
+
+    uint64_t programs = 0;
+    uint64_t errors = 0;
+    uint64_t too_deep = 0;  // errors for nesting beyond max_nesting_depth, not evaluated
+    uint64_t checksum = 0;
+    uint64_t parse_ns = 0;
+    ProgramSplitter splitter{[&](const char* program, size_t length) {
+        ++programs;
+        // The engines recurse, so a line nested deeply enough would
+        // overflow the stack and end the run.
+        if (!nesting_depth_within(program, length, max_nesting_depth)) {
+            ++errors;
+            ++too_deep;
+            return;
+        }
+        ErrorKind error = no_error;
+        int64_t value = engine->execute(program, length, &error);
+        errors += error != no_error;
+        checksum += static_cast<uint64_t>(value);
+    }};
+
+    uint64_t wall_before = get_monotonic_time_ns();
+    uint64_t thread_before = get_thread_time_ns();
+    uint64_t process_before = get_process_time_ns();
+    bool ok = reader->read(fd, file_size, [&](const char* data, size_t size) {
+        uint64_t before = get_thread_time_ns();
+        splitter.feed(data, size);
+        parse_ns += get_thread_time_ns() - before;
+    });
+    uint64_t before = get_thread_time_ns();
+    splitter.finish();
+    parse_ns += get_thread_time_ns() - before;
+    uint64_t wall_ns = get_monotonic_time_ns() - wall_before;
+    uint64_t thread_ns = get_thread_time_ns() - thread_before;
+    uint64_t process_ns = get_process_time_ns() - process_before;
+    ::close(fd);
+    if (!ok) {
+        std::perror(path);
+        return 1;
+    }
+
+    std::cout << "reader=" << reader->name()
+              << "  engine=" << engine_name
+              << "  bytes=" << file_size
+              << "  programs=" << programs
+              << "  reassembled=" << splitter.reassembled
+              << "  errors=" << errors
+              << "  too_deep=" << too_deep
+              << "  checksum=" << checksum
+              << "  mb_per_s=" << file_size * 1000 / std::max<uint64_t>(1, wall_ns)
+              << "  programs_per_s=" << programs * 1000000000ull / std::max<uint64_t>(1, wall_ns)
+              << "  wall_ms=" << wall_ns / 1000000
+              << "  parse_cpu_ms=" << parse_ns / 1000000
+              << "  io_cpu_ms=" << (thread_ns - std::min(thread_ns, parse_ns)) / 1000000
+              << "  process_cpu_ms=" << process_ns / 1000000
+              << '\n';
+    return 0;
+}
@@ -0,0 +1,238 @@
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "server_protocol.hpp"
+
+// parser-load: a load generator for parser-server. Every connection runs on
+// its own thread and keeps a window of requests in flight, sending the next
+// ones as the responses come back. Reports the throughput over all
+// connections and the latency of the requests, from being sent to the
+// response arriving.
+
+uint64_t get_monotonic_time_ns() {
+    timespec t;
+    ::clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1000000000ull + t.tv_nsec;
+}
+
+struct Options {
+    const char* path = nullptr;
+    Engine engine = Engine::Results;
+    size_t connections = 1;
+    size_t requests = 100000;
+    size_t pipeline = 1;
+    const char* input_file = "input.ok";
+};
+
+struct ConnectionStats {
+    std::vector<uint64_t> latencies_ns;
+    size_t errors = 0;  // responses with a non-zero status
+    bool failed = false;
+};
+
+int connect_to(const char* path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (std::strlen(path) >= sizeof(address.sun_path)) {
+        return -1;
+    }
+    std::strcpy(address.sun_path, path);
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Sends requests for the program until count have been answered, with up to
+// pipeline of them in flight at once. The socket is non-blocking, and
+// responses are read while requests are still being written: the server
+// stops reading a connection whose responses it can't write, so a client
+// that only reads once it has written everything deadlocks with it as soon
+// as the window outgrows the socket buffers.
+void run_connection(const Options& options, const std::string& request, size_t count, ConnectionStats& stats) {
+    int fd = connect_to(options.path);
+    if (fd < 0) {
+        std::perror(options.path);
+        stats.failed = true;
+        return;
+    }
+    if (::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK) != 0) {
+        std::perror("fcntl");
+        ::close(fd);
+        stats.failed = true;
+        return;
+    }
+
+    stats.latencies_ns.reserve(count);
+    std::deque<uint64_t> sent_at;
+    std::string out;
+    size_t written = 0;
+    std::string in;
+    char buffer[64 * 1024];
+    size_t sent = 0;
+    while (stats.latencies_ns.size() < count) {
+        size_t to_send = std::min(options.pipeline - sent_at.size(), count - sent);
+        if (to_send > 0) {
+            for (size_t i = 0; i < to_send; ++i) {
+                out += request;
+            }
+            sent_at.insert(sent_at.end(), to_send, get_monotonic_time_ns());
+            sent += to_send;
+        }
+
+        pollfd events{fd, static_cast<short>(POLLIN | (written < out.size() ? POLLOUT : 0)), 0};
+        if (::poll(&events, 1, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            stats.failed = true;
+            break;
+        }
+
+        if (events.revents & POLLOUT) {
+            ssize_t n = ::send(fd, out.data() + written, out.size() - written, MSG_NOSIGNAL);
+            if (n < 0 && errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK) {
+                stats.failed = true;
+                break;
+            }
+            if (n > 0) {
+                written += static_cast<size_t>(n);
+                if (written == out.size() || written >= sizeof(buffer)) {
+                    out.erase(0, written);
+                    written = 0;
+                }
+            }
+        }
+
+        if (!(events.revents & (POLLIN | POLLHUP | POLLERR))) {
+            continue;
+        }
+        ssize_t n = ::read(fd, buffer, sizeof(buffer));
+        if (n < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)) {
+            continue;
+        }
+        if (n <= 0) {
+            stats.failed = true;
+            break;
+        }
+        uint64_t now = get_monotonic_time_ns();
+        in.append(buffer, static_cast<size_t>(n));
+        size_t at = 0;
+        for (; in.size() - at >= response_size; at += response_size) {
+            if (in[at + 8] != 0) {
+                ++stats.errors;
+            }
+            stats.latencies_ns.push_back(now - sent_at.front());
+            sent_at.pop_front();
+        }
+        in.erase(0, at);
+    }
+    ::close(fd);
+}
+
+uint64_t percentile(const std::vector<uint64_t>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    size_t index = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1));
+    return sorted[index];
+}
+
+bool parse_number(const char* arg, size_t& out) {
+    std::stringstream ss;
+    ss << arg;
+    return static_cast<bool>(ss >> out) && out > 0;
+}
+
+int main(int argc, char const *argv[])
+{
+    Options options;
+    bool usage = false;
+    for (int i = 1; i < argc && !usage; ++i) {
+        bool has_value = i + 1 < argc;
+        if (std::strcmp(argv[i], "--engine") == 0 && has_value) {
+            usage = !parse_engine(argv[++i], options.engine);
+        } else if (std::strcmp(argv[i], "--connections") == 0 && has_value) {
+            usage = !parse_number(argv[++i], options.connections);
+        } else if (std::strcmp(argv[i], "--requests") == 0 && has_value) {
+            usage = !parse_number(argv[++i], options.requests);
+        } else if (std::strcmp(argv[i], "--pipeline") == 0 && has_value) {
+            usage = !parse_number(argv[++i], options.pipeline);
+        } else if (std::strcmp(argv[i], "--input") == 0 && has_value) {
+            options.input_file = argv[++i];
+        } else if (argv[i][0] != '-' && !options.path) {
+            options.path = argv[i];
+        } else {
+            usage = true;
+        }
+    }
+    if (usage || !options.path) {
+        std::cerr << "Usage: " << argv[0] << " SOCKET [--engine exceptions|results|coroutines] [--connections N]"
+                  << " [--requests N] [--pipeline N] [--input FILE]\n";
+        return 1;
+    }
+
+    std::string program;
+    std::ifstream f{options.input_file};
+    std::getline(f, program);
+    std::string request;
+    append_request(request, options.engine, program.data(), static_cast<uint32_t>(program.size()));
+
+    std::vector<ConnectionStats> stats(options.connections);
+    std::vector<std::thread> threads;
+    uint64_t before = get_monotonic_time_ns();
+    for (size_t c = 0; c < options.connections; ++c) {
+        size_t count = options.requests / options.connections + (c < options.requests % options.connections ? 1 : 0);
+        threads.emplace_back(run_connection, std::cref(options), std::cref(request), count, std::ref(stats[c]));
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    uint64_t elapsed_ns = get_monotonic_time_ns() - before;
+
+    std::vector<uint64_t> latencies;
+    size_t errors = 0;
+    for (const ConnectionStats& s : stats) {
+        if (s.failed) {
+            std::cerr << "A connection to " << options.path << " failed or was closed. Is parser-server running,"
+                      << " with the " << engine_name(options.engine) << " engine?\n";
+            return 1;
+        }
+        latencies.insert(latencies.end(), s.latencies_ns.begin(), s.latencies_ns.end());
+        errors += s.errors;
+    }
+    std::sort(latencies.begin(), latencies.end());
+
+    std::cout << "engine=" << engine_name(options.engine)
+              << "  connections=" << options.connections
+              << "  pipeline=" << options.pipeline
+              << "  requests=" << latencies.size()
+              << "  errors=" << errors
+              << "  requests_per_s=" << latencies.size() * 1000000000ull / std::max<uint64_t>(1, elapsed_ns)
+              << "  p50_ns=" << percentile(latencies, 0.5)
+              << "  p99_ns=" << percentile(latencies, 0.99)
+              << "  p999_ns=" << percentile(latencies, 0.999)
+              << "  max_ns=" << (latencies.empty() ? 0 : latencies.back())
+              << '\n';
+    return 0;
+}
@@ -1,11 +1,29 @@
 #include <sys/time.h>
 #include <sys/resource.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <sched.h>
+#include <unistd.h>
+#include <link.h>
+#include <time.h>
+#include <climits>
+#include <cstring>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
 #include <sstream>
 #include <iomanip>
 #include <fstream>
+#include <vector>
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <emmintrin.h>
+#endif
 
 #include "parser.hpp"
+#include "parser_core.hpp"
 
 uint64_t get_process_time_us() {
     rusage u;
@@ -13,6 +31,12 @@ uint64_t get_process_time_us() {
     return u.ru_utime.tv_sec * 1000000 + u.ru_utime.tv_usec;
 }
 
+uint64_t get_monotonic_time_ns() {
+    timespec t;
+    ::clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1000000000ull + t.tv_nsec;
+}
+
 template <class F>
 __attribute__((noinline))
 uint64_t time_lambda_us(F func)
@@ -23,10 +47,12 @@ uint64_t time_lambda_us(F func)
     return after - before;
 }
 
-struct TestParserWithExceptions {
+// Runs the first line of input_file through an engine, by virtual call.
+template <std::unique_ptr<IParser> (*make_parser)()>
+struct TestParser {
     std::unique_ptr<IParser> calc;
     std::string program;
-    TestParserWithExceptions(const char* input_file) : calc(make_parser_with_exceptions()) {
+    TestParser(const char* input_file) : calc(make_parser()) {
         std::ifstream f{input_file};
         std::getline(f, program);
     }
@@ -37,18 +63,443 @@ struct TestParserWithExceptions {
     }
 };
 
-struct TestParserWithResults {
-    std::unique_ptr<IParser> calc;
+#if defined(PARSER_COROUTINES)
+struct TestParserWithCoroutines : TestParser<make_parser_with_coroutines> {
+    using TestParser<make_parser_with_coroutines>::TestParser;
+
+    uint64_t frames_allocated() const {
+        return coroutine_frames_allocated();
+    }
+};
+#endif
+
+// The same tests without the virtual call: the first calls the engine's C
+// entry point in the other translation unit, the second instantiates the
+// engine's grammar right here, where it can be inlined into the loop.
+template <int64_t (*execute)(const char*, size_t, int*)>
+struct TestCrossTU {
     std::string program;
-    TestParserWithResults(const char* input_file) : calc(make_parser_with_results()) {
+    TestCrossTU(const char* input_file) {
         std::ifstream f{input_file};
         std::getline(f, program);
     }
 
+    uint64_t run(uint64_t state) {
+        int64_t result = execute(program.data(), program.size(), nullptr);
+        return static_cast<uint64_t>(result);
+    }
+};
+
+template <class ErrorPolicy, class Arithmetic = CheckedArithmetic>
+struct TestStatic {
+    std::string program;
+    TestStatic(const char* input_file) {
+        std::ifstream f{input_file};
+        std::getline(f, program);
+    }
+
+    uint64_t run(uint64_t state) {
+        int64_t result = execute_program<ErrorPolicy, Arithmetic>(program.data(), program.size());
+        return static_cast<uint64_t>(result);
+    }
+};
+
+// The static test with arbitrary-precision arithmetic, where every value
+// stays on the int64_t fast path.
+template <class ErrorPolicy>
+struct TestStaticBig {
+    std::string program;
+    TestStaticBig(const char* input_file) {
+        std::ifstream f{input_file};
+        std::getline(f, program);
+    }
+
+    uint64_t run(uint64_t state) {
+        BigArena arena;
+        Result<BigValue> result = evaluate<ErrorPolicy, BigArithmetic>(program.data(), program.data() + program.size(),
+                                                                        BigArithmetic{&arena});
+        return result.is_error ? 0 : static_cast<uint64_t>(result.ok.small);
+    }
+};
+
+// A program parsed once by make_program_with_jit, which runs as bytecode for
+// its first jit_threshold calls and as native code afterwards.
+struct TestProgramWithJit {
+    std::unique_ptr<IProgram> program;
+    TestProgramWithJit(const char* input_file, unsigned jit_threshold) {
+        std::string text;
+        std::ifstream f{input_file};
+        std::getline(f, text);
+        program = make_program_with_jit(text.data(), text.size(), jit_threshold);
+    }
+
+    uint64_t run(uint64_t state) {
+        int64_t result = program->execute();
+        return static_cast<uint64_t>(result);
+    }
+
+    size_t memory_bytes() const {
+        return program->memory_bytes();
+    }
+};
+
+// One formula, compiled once and evaluated for each of rows sets of bindings,
+// like a column computed over a table.
+std::unique_ptr<IProgram> compile_with_exceptions(const char* program, size_t length, const std::vector<std::string>& names) {
+    return make_parser_with_exceptions()->compile(program, length, names);
+}
+
+std::unique_ptr<IProgram> compile_with_results(const char* program, size_t length, const std::vector<std::string>& names) {
+    return make_parser_with_results()->compile(program, length, names);
+}
+
+std::unique_ptr<IProgram> compile_with_jit(const char* program, size_t length, const std::vector<std::string>& names) {
+    return make_program_with_jit(program, length, names, 0);
+}
+
+const char* const bindings_formula = "(+ (* price quantity) (/ (- total discount) 100))";
+
+template <std::unique_ptr<IProgram> (*compile)(const char*, size_t, const std::vector<std::string>&)>
+struct TestBindings {
+    std::unique_ptr<IProgram> program;
+    std::vector<int64_t> bindings;
+    size_t rows;
+    TestBindings(size_t rows) : rows(rows) {
+        program = compile(bindings_formula, std::strlen(bindings_formula), {"price", "quantity", "total", "discount"});
+        bindings.resize(rows * 4);
+        for (size_t i = 0; i < bindings.size(); ++i) {
+            bindings[i] = static_cast<int64_t>(i * 2654435761 % 100000);
+        }
+    }
+
+    uint64_t run(uint64_t state) {
+        uint64_t sum = 0;
+        for (size_t row = 0; row < rows; ++row) {
+            sum += static_cast<uint64_t>(program->execute(&bindings[row * 4], nullptr));
+        }
+        return sum;
+    }
+};
+
+// The same formula over columns of 4 * rows bindings, evaluated a block of
+// rows at a time with the given instruction set.
+template <ColumnIsa isa>
+struct TestColumns {
+    Bytecode bytecode;
+    std::vector<std::vector<int64_t>> columns;
+    std::vector<const int64_t*> column_pointers;
+    std::vector<int64_t> results;
+    std::vector<uint64_t> errors;
+    size_t rows;
+    TestColumns(size_t rows)
+        : bytecode(bindings_formula, std::strlen(bindings_formula), {"price", "quantity", "total", "discount"}),
+          columns(4, std::vector<int64_t>(rows)), results(rows), errors((rows + 63) / 64), rows(rows) {
+        for (size_t row = 0; row < rows; ++row) {
+            for (size_t c = 0; c < 4; ++c) {
+                columns[c][row] = static_cast<int64_t>((row * 4 + c) * 2654435761 % 100000);
+            }
+        }
+        for (const std::vector<int64_t>& column : columns) {
+            column_pointers.push_back(column.data());
+        }
+    }
+
+    uint64_t run(uint64_t state) {
+        execute_bytecode_columns(bytecode, isa, column_pointers.data(), rows, results.data(), errors.data());
+        return static_cast<uint64_t>(results[state % rows]);
+    }
+};
+
+// The latency of getting to native code: parsing, compiling and one call.
+struct TestJitCompile {
+    std::string program;
+    TestJitCompile(const char* input_file) {
+        std::ifstream f{input_file};
+        std::getline(f, program);
+    }
+
+    uint64_t run(uint64_t state) {
+        int64_t result = make_program_with_jit(program.data(), program.size(), 0)->execute();
+        return static_cast<uint64_t>(result);
+    }
+};
+
+#if __cplusplus >= 202002L
+// The same program as input.ok, evaluated by the compiler.
+struct TestConstantProgram {
+    uint64_t run(uint64_t state) {
+        constexpr int64_t result = evaluate_constant("+ (+ (+ 2 (* 5 3)) (- 10 (/ 8 4))) (+ (+ 2 (* 5 3)) (- 10 (/ 8 4)))");
+        return static_cast<uint64_t>(result);
+    }
+};
+#endif
+
+// A program of 2^depth numbers in a balanced tree of parenthesized
+// expressions, for measuring how parsing scales with the size of the input.
+void append_large_program(std::string& out, unsigned depth, unsigned& counter) {
+    if (depth == 0) {
+        out += std::to_string(counter++ % 100);
+        return;
+    }
+    out += depth % 2 ? "(+ " : "(- ";
+    append_large_program(out, depth - 1, counter);
+    out += ' ';
+    append_large_program(out, depth - 1, counter);
+    out += ')';
+}
+
+std::vector<char> make_large_program(unsigned depth) {
+    std::string program;
+    unsigned counter = 0;
+    append_large_program(program, depth, counter);
+    return std::vector<char>(program.begin(), program.end());
+}
+
+// The large program lives in a plain buffer, like a caller's mmap'd file or
+// protocol frame. The first test copies it into a std::string for every call,
+// the second passes it as it is, and the third goes through the C entry point.
+template <std::unique_ptr<IParser> (*make_parser)()>
+struct TestLargeProgramCopy {
+    std::unique_ptr<IParser> calc;
+    std::vector<char> program;
+    TestLargeProgramCopy(unsigned depth) : calc(make_parser()), program(make_large_program(depth)) {}
+
+    uint64_t run(uint64_t state) {
+        int64_t result = calc->execute(std::string(program.begin(), program.end()));
+        return static_cast<uint64_t>(result);
+    }
+};
+
+template <std::unique_ptr<IParser> (*make_parser)()>
+struct TestLargeProgramZeroCopy {
+    std::unique_ptr<IParser> calc;
+    std::vector<char> program;
+    TestLargeProgramZeroCopy(unsigned depth) : calc(make_parser()), program(make_large_program(depth)) {}
+
+    uint64_t run(uint64_t state) {
+        int64_t result = calc->execute(program.data(), program.size());
+        return static_cast<uint64_t>(result);
+    }
+};
+
+template <int64_t (*execute)(const char*, size_t, int*)>
+struct TestLargeProgramCAbi {
+    std::vector<char> program;
+    TestLargeProgramCAbi(unsigned depth) : program(make_large_program(depth)) {}
+
+    uint64_t run(uint64_t state) {
+        int64_t result = execute(program.data(), program.size(), nullptr);
+        return static_cast<uint64_t>(result);
+    }
+};
+
+struct TestLargeProgramJit {
+    std::unique_ptr<IProgram> program;
+    TestLargeProgramJit(unsigned depth) {
+        std::vector<char> text = make_large_program(depth);
+        program = make_program_with_jit(text.data(), text.size(), 0);
+    }
+
+    uint64_t run(uint64_t state) {
+        int64_t result = program->execute();
+        return static_cast<uint64_t>(result);
+    }
+
+    size_t memory_bytes() const {
+        return program->memory_bytes();
+    }
+};
+
+// The large program at a greater depth, tens of MB, evaluated with
+// execute_in_parallel on the given number of threads (0 for one per core).
+struct TestParallelProgram {
+    std::vector<char> program;
+    unsigned threads;
+    TestParallelProgram(unsigned depth, unsigned threads) : program(make_large_program(depth)), threads(threads) {}
+
+    uint64_t run(uint64_t state) {
+        int64_t result = execute_in_parallel(program.data(), program.size(), nullptr, threads);
+        return static_cast<uint64_t>(result);
+    }
+};
+
+// 2^depth subtractions of two 18-digit numbers, summed up, so that the time
+// is dominated by reading digits.
+void append_long_numbers_program(std::string& out, unsigned depth, uint64_t& counter) {
+    if (depth == 0) {
+        uint64_t left = 100000000000000000ull + counter * 7919 % 800000000000000000ull;
+        out += "(- " + std::to_string(left) + ' ' + std::to_string(left - counter % 100) + ')';
+        ++counter;
+        return;
+    }
+    out += "(+ ";
+    append_long_numbers_program(out, depth - 1, counter);
+    out += ' ';
+    append_long_numbers_program(out, depth - 1, counter);
+    out += ')';
+}
+
+template <std::unique_ptr<IParser> (*make_parser)()>
+struct TestLongNumbers {
+    std::unique_ptr<IParser> calc;
+    std::string program;
+    size_t digits = 0;
+    TestLongNumbers(unsigned depth) : calc(make_parser()) {
+        uint64_t counter = 0;
+        append_long_numbers_program(program, depth, counter);
+        digits = std::count_if(program.begin(), program.end(), [](char c) { return is_digit(c); });
+    }
+
     uint64_t run(uint64_t state) {
         int64_t result = calc->execute(program);
         return static_cast<uint64_t>(result);
-    } 
+    }
+};
+
+// The product of 2^depth 18-digit numbers, of about 2^depth * 18 digits.
+void append_big_numbers_program(std::string& out, unsigned depth, uint64_t& counter) {
+    if (depth == 0) {
+        counter = counter * 6364136223846793005 + 1442695040888963407;
+        out += std::to_string(100000000000000000 + counter % 900000000000000000);
+        return;
+    }
+    out += "(* ";
+    append_big_numbers_program(out, depth - 1, counter);
+    out += ' ';
+    append_big_numbers_program(out, depth - 1, counter);
+    out += ')';
+}
+
+template <std::unique_ptr<IParser> (*make_parser)()>
+struct TestBigNumbers {
+    std::unique_ptr<IParser> calc;
+    std::string program;
+    TestBigNumbers(unsigned depth) : calc(make_parser()) {
+        uint64_t counter = 0;
+        append_big_numbers_program(program, depth, counter);
+    }
+
+    uint64_t run(uint64_t state) {
+        std::string result = calc->execute_big(program.data(), program.size());
+        return result.size();
+    }
+};
+
+// A program of 2^depth numbers, pretty-printed with one operand per line
+// and four spaces of indentation per level.
+void append_pretty_program(std::string& out, unsigned depth, unsigned indent, unsigned& counter) {
+    out += '\n';
+    out.append(indent * 4, ' ');
+    if (depth == 0) {
+        out += std::to_string(counter++ % 100);
+        return;
+    }
+    out += depth % 2 ? "(+" : "(-";
+    append_pretty_program(out, depth - 1, indent + 1, counter);
+    append_pretty_program(out, depth - 1, indent + 1, counter);
+    out += ')';
+}
+
+template <std::unique_ptr<IParser> (*make_parser)()>
+struct TestPrettyProgram {
+    std::unique_ptr<IParser> calc;
+    std::string program;
+    TestPrettyProgram(unsigned depth) : calc(make_parser()) {
+        unsigned counter = 0;
+        append_pretty_program(program, depth, 0, counter);
+    }
+
+    uint64_t run(uint64_t state) {
+        int64_t result = calc->execute(program);
+        return static_cast<uint64_t>(result);
+    }
+};
+
+// Puts the process back into the state of a program that hasn't thrown in a
+// long time: every loaded segment (our code, libstdc++, the unwinder in libgcc
+// and their .eh_frame, .eh_frame_hdr and .gcc_except_table) and the program
+// text are flushed out of every cache level with clflush. A generated
+// function then runs a chain of taken conditional branches, one per cache
+// line of 4 MiB, each to the next line: it evicts the instruction and uop
+// caches, and its 65535 branches, all at different addresses, fill the
+// branch target buffer and the predictor tables with their own entries.
+struct ColdCache {
+    struct Range {
+        const char* begin;
+        size_t size;
+    };
+    std::vector<Range> segments;
+    void* thrash_code = nullptr;
+    size_t thrash_size = 4 << 20;
+
+    ColdCache() {
+        ::dl_iterate_phdr(&add_segments, this);
+#if defined(__x86_64__) || defined(__i386__)
+        void* code = ::mmap(nullptr, thrash_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (code != MAP_FAILED) {
+            unsigned char* bytes = static_cast<unsigned char*>(code);
+            std::memset(bytes, 0xcc, thrash_size);   // int3
+            bytes[0] = 0x31;                         // xor eax, eax, which sets ZF
+            bytes[1] = 0xc0;
+            for (size_t line = 0; line + 64 < thrash_size; line += 64) {
+                size_t at = line == 0 ? 2 : line;
+                int32_t offset = static_cast<int32_t>(line + 64 - (at + 6));
+                bytes[at] = 0x0f;                    // jz rel32, to the next line
+                bytes[at + 1] = 0x84;
+                std::memcpy(bytes + at + 2, &offset, sizeof(offset));
+            }
+            bytes[thrash_size - 64] = 0xc3;          // ret
+            if (::mprotect(code, thrash_size, PROT_READ | PROT_EXEC) == 0) {
+                thrash_code = code;
+            } else {
+                ::munmap(code, thrash_size);
+            }
+        }
+#endif
+    }
+
+    ~ColdCache() {
+        if (thrash_code) {
+            ::munmap(thrash_code, thrash_size);
+        }
+    }
+
+    static int add_segments(dl_phdr_info* info, size_t, void* data) {
+        ColdCache* self = static_cast<ColdCache*>(data);
+        for (int i = 0; i < info->dlpi_phnum; ++i) {
+            const auto& phdr = info->dlpi_phdr[i];
+            if (phdr.p_type == PT_LOAD && (phdr.p_flags & PF_R)) {
+                const char* begin = reinterpret_cast<const char*>(info->dlpi_addr + phdr.p_vaddr);
+                self->segments.push_back(Range{begin, static_cast<size_t>(phdr.p_memsz)});
+            }
+        }
+        return 0;
+    }
+
+    static void flush(const char* begin, size_t size) {
+#if defined(__x86_64__) || defined(__i386__)
+        for (size_t offset = 0; offset < size; offset += 64) {
+            _mm_clflush(begin + offset);
+        }
+#else
+        (void)begin;
+        (void)size;
+#endif
+    }
+
+    __attribute__((noinline))
+    void evict(const std::string& program) {
+        if (thrash_code) {
+            reinterpret_cast<void (*)()>(thrash_code)();
+        }
+        for (const Range& segment : segments) {
+            flush(segment.begin, segment.size);
+        }
+        flush(program.data(), program.size());
+#if defined(__x86_64__) || defined(__i386__)
+        _mm_mfence();
+#endif
+    }
 };
 
 #if !defined(COMPILER)
@@ -60,50 +511,627 @@ struct TestParserWithResults {
 
 #define COMPILER_NAME Q(COMPILER)
 
-template <class Test, class... Args>
-__attribute__((noinline))
-uint64_t run_benchmark(uint64_t state, const char* description, size_t iterations, Args&&... args) {
-    Test test{std::forward<Args>(args)...};
+#if defined(COMPILER_FLAGS)
+#define COMPILER_FLAGS_STRING Q(COMPILER_FLAGS)
+#else
+#define COMPILER_FLAGS_STRING "unknown"
+#endif
 
-    std::ofstream csv{"results.csv", std::ios_base::app};
+#if defined(GIT_SHA)
+#define GIT_SHA_STRING Q(GIT_SHA)
+#else
+#define GIT_SHA_STRING "unknown"
+#endif
+
+std::string get_host_name() {
+    char name[256] = {};
+    if (::gethostname(name, sizeof(name) - 1) != 0) {
+        return "unknown";
+    }
+    return name;
+}
+
+std::string get_cpu_model() {
+    std::ifstream cpuinfo{"/proc/cpuinfo"};
+    std::string line;
+    while (std::getline(cpuinfo, line)) {
+        if (line.compare(0, 10, "model name") == 0) {
+            size_t colon = line.find(':');
+            if (colon != std::string::npos) {
+                return line.substr(line.find_first_not_of(' ', colon + 1));
+            }
+        }
+    }
+    return "unknown";
+}
+
+void write_json_string(std::ostream& os, const std::string& str) {
+    os << '"';
+    for (char c : str) {
+        switch (c) {
+            case '"': os << "\\\""; break;
+            case '\\': os << "\\\\"; break;
+            case '\n': os << "\\n"; break;
+            case '\t': os << "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    os << "\\u" << std::hex << std::setw(4) << std::setfill('0') << int(c) << std::dec << std::setfill(' ');
+                } else {
+                    os << c;
+                }
+        }
+    }
+    os << '"';
+}
+
+struct Options {
+    size_t iterations = 0;
+    size_t repetitions = 1;
+    bool cold = false;
+    int cpu = -1;
+    bool high_priority = false;
+    bool fork = true;
+    const char* only = nullptr;  // the one benchmark to run, if not all
+    size_t seconds = 0;          // how long to keep running, if set
+};
+
+// A named series of samples, one per repetition.
+struct Metric {
+    const char* name;
+    std::vector<uint64_t> samples;
+};
+
+uint64_t median(std::vector<uint64_t> samples) {
+    std::sort(samples.begin(), samples.end());
+    return samples[samples.size() / 2];
+}
+
+// Appends one JSON object per benchmark to results.jsonl, with everything
+// needed to tell two result sets apart (see scripts/compare_results.py).
+void write_json_result(const char* description, size_t iterations, const std::vector<Metric>& metrics) {
+    static const std::string host = get_host_name();
+    static const std::string cpu = get_cpu_model();
 
+    std::ofstream json{"results.jsonl", std::ios_base::app};
+    json << "{\"host\":"; write_json_string(json, host);
+    json << ",\"cpu\":"; write_json_string(json, cpu);
+    json << ",\"compiler\":"; write_json_string(json, COMPILER_NAME);
+    json << ",\"compiler_version\":"; write_json_string(json, __VERSION__);
+    json << ",\"flags\":"; write_json_string(json, COMPILER_FLAGS_STRING);
+    json << ",\"git_sha\":"; write_json_string(json, GIT_SHA_STRING);
+    json << ",\"benchmark\":"; write_json_string(json, description);
+    json << ",\"iterations\":" << iterations;
+    json << ",\"metrics\":{";
+    for (size_t m = 0; m < metrics.size(); ++m) {
+        json << (m ? "," : "") << '"' << metrics[m].name << "\":[";
+        for (size_t i = 0; i < metrics[m].samples.size(); ++i) {
+            json << (i ? "," : "") << metrics[m].samples[i];
+        }
+        json << ']';
+    }
+    json << "}}\n";
+}
+
+void begin_benchmark(const char* description) {
     std::cout << std::setw(20) << std::right << COMPILER_NAME;
     std::cout << "  ";
     std::cout << std::setw(50) << std::left << description;
-    std::cout << "  ";
+    std::cout << "  " << std::flush;
+}
 
+// Reports the median of every metric. The first metric must be "us", which
+// is what goes into results.csv.
+void end_benchmark(const char* description, size_t iterations, const std::vector<Metric>& metrics) {
+    std::ofstream csv{"results.csv", std::ios_base::app};
     csv << COMPILER_NAME << ';' << description << ';';
 
+    uint64_t us = median(metrics[0].samples);
+    std::cout << std::setw(10) << std::right << us << "µs";
+    for (size_t m = 1; m < metrics.size(); ++m) {
+        std::cout << "  " << metrics[m].name << '=' << median(metrics[m].samples);
+    }
+    std::cout << '\n';
+    csv << us << '\n';
+    write_json_result(description, iterations, metrics);
+}
+
+#if defined(PARSER_COUNTERS)
+// Prints what the grammar did on this thread (see ParserCounters), per call
+// of the benchmark, and starts counting from zero again.
+void dump_counters(uint64_t calls) {
+    static const char* const error_names[] = {
+        "InvalidOperator", "InvalidCharacter", "UnexpectedEOF", "DivideByZero", "Overflow", "UnknownVariable",
+    };
+    ParserCounters& counters = parser_counters();
+    double per_call = 1.0 / static_cast<double>(std::max<uint64_t>(1, calls));
+    uint64_t errors = 0;
+    std::cout << std::setw(22) << "" << std::fixed << std::setprecision(1)
+              << "get_char=" << static_cast<double>(counters.get_char) * per_call
+              << "  peek=" << static_cast<double>(counters.peek) * per_call
+              << "  expression=" << static_cast<double>(counters.expression) * per_call
+              << "  max_depth=" << counters.max_depth;
+    for (size_t kind = 0; kind < 6; ++kind) {
+        if (counters.errors[kind]) {
+            std::cout << "  " << error_names[kind] << '=' << static_cast<double>(counters.errors[kind]) * per_call;
+            errors += counters.errors[kind];
+        }
+    }
+    if (errors) {
+        std::cout << "  frames_unwound_per_error="
+                  << static_cast<double>(counters.frames_unwound) / static_cast<double>(errors);
+    }
+    std::cout << std::defaultfloat << '\n';
+    counters = ParserCounters{};
+}
+#endif
+
+template <class Test, class... Args>
+__attribute__((noinline))
+uint64_t measure_benchmark(uint64_t state, const char* description, const Options& options, Args&&... args) {
+    Test test{std::forward<Args>(args)...};
+
+    begin_benchmark(description);
+#if defined(PARSER_COUNTERS)
+    parser_counters() = ParserCounters{};
+#endif
 
-    auto us = time_lambda_us([&]() {
+    // With --seconds, repetitions go on until the time is up, which gives a
+    // profiler enough samples of one benchmark (see scripts/flamegraph.sh).
+    Metric us{"us", {}};
+    uint64_t deadline = get_monotonic_time_ns() + options.seconds * 1000000000ull;
+    for (size_t r = 0; r < options.repetitions || get_monotonic_time_ns() < deadline; ++r) {
+        us.samples.push_back(time_lambda_us([&]() {
+            for (size_t i = 0; i < options.iterations; ++i) {
+                state += test.run(state);
+            }
+        }));
+    }
+
+    end_benchmark(description, options.iterations, {us});
+#if defined(PARSER_COUNTERS)
+    dump_counters(options.iterations * us.samples.size());
+#endif
+    return state;
+}
+
+// Like measure_benchmark, but every call starts with cold caches (see
+// ColdCache), and only the calls themselves are timed. Evicting is expensive,
+// so this runs a hundredth of the iterations. Reports the total time of the
+// calls and the median latency of a single call.
+template <class Test, class... Args>
+__attribute__((noinline))
+uint64_t measure_cold_benchmark(uint64_t state, const char* description, const Options& options, Args&&... args) {
+    Test test{std::forward<Args>(args)...};
+    ColdCache cold;
+    size_t iterations = std::max<size_t>(1, options.iterations / 100);
+
+    begin_benchmark(description);
+
+    Metric us{"us", {}};
+    Metric ns_per_call{"ns_per_call", {}};
+    std::vector<uint64_t> latencies(iterations);
+    for (size_t r = 0; r < options.repetitions; ++r) {
+        uint64_t total = 0;
         for (size_t i = 0; i < iterations; ++i) {
+            cold.evict(test.program);
+            uint64_t before = get_monotonic_time_ns();
             state += test.run(state);
+            uint64_t after = get_monotonic_time_ns();
+            latencies[i] = after - before;
+            total += latencies[i];
         }
-    });
+        us.samples.push_back(total / 1000);
+        ns_per_call.samples.push_back(median(latencies));
+    }
 
-    std::cout << std::setw(10) << std::right << us << "µs\n";
-    csv << us << '\n';
+    end_benchmark(description, iterations, {us, ns_per_call});
+    return state;
+}
+
+// Like measure_benchmark, for tests that count the digits in their program,
+// additionally reporting the time per digit in picoseconds.
+template <class Test, class... Args>
+__attribute__((noinline))
+uint64_t measure_digits_benchmark(uint64_t state, const char* description, const Options& options, Args&&... args) {
+    Test test{std::forward<Args>(args)...};
+
+    begin_benchmark(description);
+
+    Metric us{"us", {}};
+    Metric ps_per_digit{"ps_per_digit", {}};
+    for (size_t r = 0; r < options.repetitions; ++r) {
+        uint64_t sample = time_lambda_us([&]() {
+            for (size_t i = 0; i < options.iterations; ++i) {
+                state += test.run(state);
+            }
+        });
+        us.samples.push_back(sample);
+        ps_per_digit.samples.push_back(sample * 1000000 / std::max<uint64_t>(1, test.digits * options.iterations));
+    }
+
+    end_benchmark(description, options.iterations, {us, ps_per_digit});
+    return state;
+}
+
+// Like measure_benchmark, for tests that hold on to memory, additionally
+// reporting how many bytes.
+template <class Test, class... Args>
+__attribute__((noinline))
+uint64_t measure_memory_benchmark(uint64_t state, const char* description, const Options& options, Args&&... args) {
+    Test test{std::forward<Args>(args)...};
+
+    begin_benchmark(description);
+
+    Metric us{"us", {}};
+    Metric bytes{"bytes", {}};
+    for (size_t r = 0; r < options.repetitions; ++r) {
+        us.samples.push_back(time_lambda_us([&]() {
+            for (size_t i = 0; i < options.iterations; ++i) {
+                state += test.run(state);
+            }
+        }));
+        bytes.samples.push_back(test.memory_bytes());
+    }
+
+    end_benchmark(description, options.iterations, {us, bytes});
+    return state;
+}
+
+// Like measure_benchmark, for tests that count the frames they allocate,
+// additionally reporting how many per call.
+template <class Test, class... Args>
+__attribute__((noinline))
+uint64_t measure_frames_benchmark(uint64_t state, const char* description, const Options& options, Args&&... args) {
+    Test test{std::forward<Args>(args)...};
+
+    begin_benchmark(description);
+
+    Metric us{"us", {}};
+    Metric frames_per_call{"frames_per_call", {}};
+    for (size_t r = 0; r < options.repetitions; ++r) {
+        uint64_t before = test.frames_allocated();
+        us.samples.push_back(time_lambda_us([&]() {
+            for (size_t i = 0; i < options.iterations; ++i) {
+                state += test.run(state);
+            }
+        }));
+        frames_per_call.samples.push_back((test.frames_allocated() - before) / std::max<size_t>(1, options.iterations));
+    }
+
+    end_benchmark(description, options.iterations, {us, frames_per_call});
     return state;
 }
 
+// Like measure_benchmark, for tests that evaluate rows of bindings,
+// additionally reporting the rows per second.
+template <class Test, class... Args>
+__attribute__((noinline))
+uint64_t measure_rows_benchmark(uint64_t state, const char* description, const Options& options, Args&&... args) {
+    Test test{std::forward<Args>(args)...};
+
+    begin_benchmark(description);
+
+    Metric us{"us", {}};
+    Metric rows_per_s{"rows_per_s", {}};
+    for (size_t r = 0; r < options.repetitions; ++r) {
+        uint64_t sample = time_lambda_us([&]() {
+            for (size_t i = 0; i < options.iterations; ++i) {
+                state += test.run(state);
+            }
+        });
+        us.samples.push_back(sample);
+        rows_per_s.samples.push_back(test.rows * options.iterations * 1000000 / std::max<uint64_t>(1, sample));
+    }
+
+    end_benchmark(description, options.iterations, {us, rows_per_s});
+    return state;
+}
+
+// Runs func in a fresh child process, so that the caches, branch predictors
+// and allocator state warmed up by one benchmark can't leak into the next.
+// With --only, every other benchmark is skipped.
+template <class F>
+uint64_t run_isolated(uint64_t state, const char* description, const Options& options, F func) {
+    if (options.only && std::strcmp(options.only, description) != 0) {
+        return state;
+    }
+    if (!options.fork) {
+        return func();
+    }
+
+    std::cout.flush();
+    pid_t pid = ::fork();
+    if (pid < 0) {
+        std::perror("fork");
+        std::exit(1);
+    }
+    if (pid == 0) {
+        func();
+        std::cout.flush();
+        ::_exit(0);
+    }
+
+    int status = 0;
+    if (::waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        std::cerr << "Benchmark process failed.\n";
+        std::exit(1);
+    }
+    return state;
+}
+
+template <class Test, class... Args>
+uint64_t run_benchmark(uint64_t state, const char* description, const Options& options, Args&&... args) {
+    return run_isolated(state, description, options, [&]() {
+        return measure_benchmark<Test>(state, description, options, std::forward<Args>(args)...);
+    });
+}
+
+template <class Test, class... Args>
+uint64_t run_cold_benchmark(uint64_t state, const char* description, const Options& options, Args&&... args) {
+    return run_isolated(state, description, options, [&]() {
+        return measure_cold_benchmark<Test>(state, description, options, std::forward<Args>(args)...);
+    });
+}
+
+template <class Test, class... Args>
+uint64_t run_digits_benchmark(uint64_t state, const char* description, const Options& options, Args&&... args) {
+    return run_isolated(state, description, options, [&]() {
+        return measure_digits_benchmark<Test>(state, description, options, std::forward<Args>(args)...);
+    });
+}
+
+template <class Test, class... Args>
+uint64_t run_memory_benchmark(uint64_t state, const char* description, const Options& options, Args&&... args) {
+    return run_isolated(state, description, options, [&]() {
+        return measure_memory_benchmark<Test>(state, description, options, std::forward<Args>(args)...);
+    });
+}
+
+template <class Test, class... Args>
+uint64_t run_frames_benchmark(uint64_t state, const char* description, const Options& options, Args&&... args) {
+    return run_isolated(state, description, options, [&]() {
+        return measure_frames_benchmark<Test>(state, description, options, std::forward<Args>(args)...);
+    });
+}
+
+template <class Test, class... Args>
+uint64_t run_rows_benchmark(uint64_t state, const char* description, const Options& options, Args&&... args) {
+    return run_isolated(state, description, options, [&]() {
+        return measure_rows_benchmark<Test>(state, description, options, std::forward<Args>(args)...);
+    });
+}
+
+// Warns if a CPU the benchmarks may run on isn't using the "performance"
+// scaling governor. Machines without cpufreq (most VMs) are left alone.
+void check_scaling_governor(const cpu_set_t& cpus) {
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (!CPU_ISSET(cpu, &cpus)) {
+            continue;
+        }
+        std::ifstream f{"/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/cpufreq/scaling_governor"};
+        std::string governor;
+        if (std::getline(f, governor) && governor != "performance") {
+            std::cerr << "Warning: CPU " << cpu << " uses the \"" << governor
+                      << "\" scaling governor, results will vary. Consider switching to \"performance\".\n";
+        }
+    }
+}
+
+// Pins the process (and so every benchmark process) to options.cpu and
+// raises its priority if asked to.
+bool setup_process(const Options& options) {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    if (options.cpu >= 0) {
+        CPU_SET(options.cpu, &cpus);
+        if (::sched_setaffinity(0, sizeof(cpus), &cpus) != 0) {
+            std::perror("sched_setaffinity");
+            return false;
+        }
+    } else if (::sched_getaffinity(0, sizeof(cpus), &cpus) != 0) {
+        CPU_ZERO(&cpus);
+    }
+
+    if (options.high_priority && ::setpriority(PRIO_PROCESS, 0, -20) != 0) {
+        std::cerr << "Warning: cannot raise priority (" << std::strerror(errno) << "), running at normal priority.\n";
+    }
+
+    check_scaling_governor(cpus);
+    return true;
+}
+
+bool parse_number(const char* arg, size_t& out) {
+    std::stringstream ss;
+    ss << arg;
+    return static_cast<bool>(ss >> out);
+}
+
 int main(int argc, char const *argv[])
 {
-    if (argc != 2) {
-        std::cerr << "Please give number of iterations as argument.\n";
+    Options options;
+    std::vector<const char*> positional;
+    for (int i = 1; i < argc; ++i) {
+        size_t cpu;
+        if (std::strcmp(argv[i], "--cold") == 0) {
+            options.cold = true;
+        } else if (std::strcmp(argv[i], "--cpu") == 0 && i + 1 < argc && parse_number(argv[i + 1], cpu) && cpu < CPU_SETSIZE) {
+            options.cpu = static_cast<int>(cpu);
+            ++i;
+        } else if (std::strcmp(argv[i], "--high-priority") == 0) {
+            options.high_priority = true;
+        } else if (std::strcmp(argv[i], "--no-fork") == 0) {
+            options.fork = false;
+        } else if (std::strcmp(argv[i], "--only") == 0 && i + 1 < argc) {
+            options.only = argv[++i];
+        } else if (std::strcmp(argv[i], "--seconds") == 0 && i + 1 < argc && parse_number(argv[i + 1], options.seconds)) {
+            ++i;
+        } else if (argv[i][0] == '-') {
+            positional.clear();
+            break;
+        } else {
+            positional.push_back(argv[i]);
+        }
+    }
+
+    if (positional.size() != 1 && positional.size() != 2) {
+        std::cerr << "Usage: " << argv[0] << " ITERATIONS [REPETITIONS] [--cold] [--cpu N] [--high-priority] [--no-fork]"
+                     " [--only BENCHMARK] [--seconds N]\n";
         return 1;
     }
 
-    std::stringstream ss;
-    ss << argv[1];
-    size_t iterations;
-    if (!(ss >> iterations)) {
+    if (!parse_number(positional[0], options.iterations)) {
         std::cerr << "First argument must be a number.\n";
         return 1;
     }
 
-    run_benchmark<TestParserWithExceptions>(0, "parser-exceptions-no-errors", iterations, "input.ok");
-    run_benchmark<TestParserWithResults>(0, "parser-results-no-errors", iterations, "input.ok");
-    run_benchmark<TestParserWithExceptions>(0, "parser-exceptions-with-errors", iterations, "input.err");
-    run_benchmark<TestParserWithResults>(0, "parser-results-with-errors", iterations, "input.err");
+    if (positional.size() == 2) {
+        if (!parse_number(positional[1], options.repetitions) || options.repetitions == 0) {
+            std::cerr << "Second argument must be a positive number.\n";
+            return 1;
+        }
+    }
+
+    if (!setup_process(options)) {
+        return 1;
+    }
+
+    if (options.cold) {
+        run_cold_benchmark<TestParser<make_parser_with_exceptions>>(0, "parser-exceptions-no-errors-cold", options, "input.ok");
+        run_cold_benchmark<TestParser<make_parser_with_results>>(0, "parser-results-no-errors-cold", options, "input.ok");
+        run_cold_benchmark<TestParser<make_parser_with_exceptions>>(0, "parser-exceptions-with-errors-cold", options, "input.err");
+        run_cold_benchmark<TestParser<make_parser_with_results>>(0, "parser-results-with-errors-cold", options, "input.err");
+        run_cold_benchmark<TestParser<make_parser_with_validation>>(0, "parser-validation-with-errors-cold", options, "input.err");
+#if defined(PARSER_COROUTINES)
+        run_cold_benchmark<TestParserWithCoroutines>(0, "parser-coroutines-no-errors-cold", options, "input.ok");
+        run_cold_benchmark<TestParserWithCoroutines>(0, "parser-coroutines-with-errors-cold", options, "input.err");
+#endif
+        return 0;
+    }
+
+    run_benchmark<TestParser<make_parser_with_exceptions>>(0, "parser-exceptions-no-errors", options, "input.ok");
+    run_benchmark<TestParser<make_parser_with_results>>(0, "parser-results-no-errors", options, "input.ok");
+    run_benchmark<TestParser<make_parser_with_exceptions>>(0, "parser-exceptions-with-errors", options, "input.err");
+    run_benchmark<TestParser<make_parser_with_results>>(0, "parser-results-with-errors", options, "input.err");
+    run_benchmark<TestParser<make_parser_with_exceptions>>(0, "parser-exceptions-divide-by-zero", options, "input.div0");
+    run_benchmark<TestParser<make_parser_with_results>>(0, "parser-results-divide-by-zero", options, "input.div0");
+    run_benchmark<TestParser<make_parser_with_validation>>(0, "parser-validation-no-errors", options, "input.ok");
+    run_benchmark<TestParser<make_parser_with_validation>>(0, "parser-validation-with-errors", options, "input.err");
+    run_benchmark<TestParser<make_parser_with_validation>>(0, "parser-validation-divide-by-zero", options, "input.div0");
+    // The bounds on what handling errors costs, for programs without any: no
+    // checks at all, and the checks with a trap on the first error.
+    run_benchmark<TestParser<make_parser_with_no_checks>>(0, "parser-no-checks-no-errors", options, "input.ok");
+    run_benchmark<TestParser<make_parser_with_abort>>(0, "parser-abort-no-errors", options, "input.ok");
+#if defined(PARSER_COROUTINES)
+    run_frames_benchmark<TestParserWithCoroutines>(0, "parser-coroutines-no-errors", options, "input.ok");
+    run_frames_benchmark<TestParserWithCoroutines>(0, "parser-coroutines-with-errors", options, "input.err");
+    run_frames_benchmark<TestParserWithCoroutines>(0, "parser-coroutines-divide-by-zero", options, "input.div0");
+#endif
+
+    run_benchmark<TestCrossTU<parser_with_exceptions_execute>>(0, "parser-exceptions-no-errors-cross-tu", options, "input.ok");
+    run_benchmark<TestCrossTU<parser_with_results_execute>>(0, "parser-results-no-errors-cross-tu", options, "input.ok");
+    run_benchmark<TestCrossTU<parser_with_exceptions_execute>>(0, "parser-exceptions-with-errors-cross-tu", options, "input.err");
+    run_benchmark<TestCrossTU<parser_with_results_execute>>(0, "parser-results-with-errors-cross-tu", options, "input.err");
+    run_benchmark<TestStatic<ExceptionPolicy>>(0, "parser-exceptions-no-errors-static", options, "input.ok");
+    run_benchmark<TestStatic<ResultPolicy>>(0, "parser-results-no-errors-static", options, "input.ok");
+    run_benchmark<TestStatic<ExceptionPolicy>>(0, "parser-exceptions-with-errors-static", options, "input.err");
+    run_benchmark<TestStatic<ResultPolicy>>(0, "parser-results-with-errors-static", options, "input.err");
+    run_benchmark<TestCrossTU<parser_with_exceptions_execute>>(0, "parser-exceptions-divide-by-zero-cross-tu", options, "input.div0");
+    run_benchmark<TestCrossTU<parser_with_results_execute>>(0, "parser-results-divide-by-zero-cross-tu", options, "input.div0");
+    run_benchmark<TestStatic<ExceptionPolicy>>(0, "parser-exceptions-divide-by-zero-static", options, "input.div0");
+    run_benchmark<TestStatic<ResultPolicy>>(0, "parser-results-divide-by-zero-static", options, "input.div0");
+    run_benchmark<TestStatic<UncheckedPolicy, UncheckedArithmetic>>(0, "parser-no-checks-no-errors-static", options, "input.ok");
+    run_benchmark<TestStatic<AbortPolicy>>(0, "parser-abort-no-errors-static", options, "input.ok");
+
+    // What checking for overflow and division by zero costs when there are
+    // no errors: compare with the *-no-errors-static benchmarks.
+    run_benchmark<TestStatic<ExceptionPolicy, UncheckedArithmetic>>(0, "parser-exceptions-no-errors-unchecked", options, "input.ok");
+    run_benchmark<TestStatic<ResultPolicy, UncheckedArithmetic>>(0, "parser-results-no-errors-unchecked", options, "input.ok");
+
+    // Arbitrary precision: the int64_t fast path against *-no-errors-static,
+    // and a product of ~4600 digits.
+    run_benchmark<TestStaticBig<ExceptionPolicy>>(0, "parser-exceptions-no-errors-big", options, "input.ok");
+    run_benchmark<TestStaticBig<ResultPolicy>>(0, "parser-results-no-errors-big", options, "input.ok");
+    Options big = options;
+    big.iterations = std::max<size_t>(1, options.iterations / 1000);
+    run_benchmark<TestBigNumbers<make_parser_with_exceptions>>(0, "parser-exceptions-big-numbers", big, 8u);
+    run_benchmark<TestBigNumbers<make_parser_with_results>>(0, "parser-results-big-numbers", big, 8u);
+
+    // Programs parsed once: the bytecode interpreter, the native code tier
+    // (the first call compiles), and the time to parse and compile, which
+    // maps pages and so is measured over a hundredth of the iterations.
+    run_memory_benchmark<TestProgramWithJit>(0, "parser-jit-no-errors-interpreted", options, "input.ok", UINT_MAX);
+    run_memory_benchmark<TestProgramWithJit>(0, "parser-jit-no-errors", options, "input.ok", 0u);
+    run_memory_benchmark<TestProgramWithJit>(0, "parser-jit-divide-by-zero", options, "input.div0", 0u);
+    Options compile = options;
+    compile.iterations = std::max<size_t>(1, options.iterations / 100);
+    run_benchmark<TestJitCompile>(0, "parser-jit-compile", compile, "input.ok");
+
+#if __cplusplus >= 202002L
+    run_benchmark<TestConstantProgram>(0, "parser-constexpr-no-errors", options);
+#endif
+
+    // ~2.5 KB of mostly 18-digit numbers.
+    Options numbers = options;
+    numbers.iterations = std::max<size_t>(1, options.iterations / 10);
+    run_digits_benchmark<TestLongNumbers<make_parser_with_exceptions>>(0, "parser-exceptions-long-numbers", numbers, 6u);
+    run_digits_benchmark<TestLongNumbers<make_parser_with_results>>(0, "parser-results-long-numbers", numbers, 6u);
+
+    // ~40 KB, three quarters of it whitespace.
+    Options pretty = options;
+    pretty.iterations = std::max<size_t>(1, options.iterations / 100);
+    run_benchmark<TestPrettyProgram<make_parser_with_exceptions>>(0, "parser-exceptions-pretty-printed", pretty, 10u);
+    run_benchmark<TestPrettyProgram<make_parser_with_results>>(0, "parser-results-pretty-printed", pretty, 10u);
+
+    // A formula over 1, 1K and 1M rows of bindings, with the number of
+    // iterations divided by the number of rows.
+    Options rows_1k = options;
+    rows_1k.iterations = std::max<size_t>(1, options.iterations / 1000);
+    Options rows_1m = options;
+    rows_1m.iterations = std::max<size_t>(1, options.iterations / 1000000);
+    run_rows_benchmark<TestBindings<compile_with_exceptions>>(0, "parser-exceptions-bindings-1", options, size_t{1});
+    run_rows_benchmark<TestBindings<compile_with_results>>(0, "parser-results-bindings-1", options, size_t{1});
+    run_rows_benchmark<TestBindings<compile_with_jit>>(0, "parser-jit-bindings-1", options, size_t{1});
+    run_rows_benchmark<TestBindings<compile_with_exceptions>>(0, "parser-exceptions-bindings-1k", rows_1k, size_t{1000});
+    run_rows_benchmark<TestBindings<compile_with_results>>(0, "parser-results-bindings-1k", rows_1k, size_t{1000});
+    run_rows_benchmark<TestBindings<compile_with_jit>>(0, "parser-jit-bindings-1k", rows_1k, size_t{1000});
+    run_rows_benchmark<TestBindings<compile_with_exceptions>>(0, "parser-exceptions-bindings-1m", rows_1m, size_t{1000000});
+    run_rows_benchmark<TestBindings<compile_with_results>>(0, "parser-results-bindings-1m", rows_1m, size_t{1000000});
+    run_rows_benchmark<TestBindings<compile_with_jit>>(0, "parser-jit-bindings-1m", rows_1m, size_t{1000000});
+
+    // The same, a column at a time: scalar, then 4 and 8 lanes.
+    run_rows_benchmark<TestColumns<ColumnIsa::Scalar>>(0, "parser-simd-columns-scalar-1k", rows_1k, size_t{1000});
+    run_rows_benchmark<TestColumns<ColumnIsa::Scalar>>(0, "parser-simd-columns-scalar-1m", rows_1m, size_t{1000000});
+    if (column_isa_supported(ColumnIsa::Avx2)) {
+        run_rows_benchmark<TestColumns<ColumnIsa::Avx2>>(0, "parser-simd-columns-avx2-1k", rows_1k, size_t{1000});
+        run_rows_benchmark<TestColumns<ColumnIsa::Avx2>>(0, "parser-simd-columns-avx2-1m", rows_1m, size_t{1000000});
+    }
+    if (column_isa_supported(ColumnIsa::Avx512)) {
+        run_rows_benchmark<TestColumns<ColumnIsa::Avx512>>(0, "parser-simd-columns-avx512-1k", rows_1k, size_t{1000});
+        run_rows_benchmark<TestColumns<ColumnIsa::Avx512>>(0, "parser-simd-columns-avx512-1m", rows_1m, size_t{1000000});
+    }
+
+    // Programs of ~400 KB, so a thousandth of the iterations.
+    Options large = options;
+    large.iterations = std::max<size_t>(1, options.iterations / 1000);
+    const unsigned depth = 16;
+    run_benchmark<TestLargeProgramCopy<make_parser_with_exceptions>>(0, "parser-exceptions-large-copy", large, depth);
+    run_benchmark<TestLargeProgramCopy<make_parser_with_results>>(0, "parser-results-large-copy", large, depth);
+    run_benchmark<TestLargeProgramZeroCopy<make_parser_with_exceptions>>(0, "parser-exceptions-large-zero-copy", large, depth);
+    run_benchmark<TestLargeProgramZeroCopy<make_parser_with_results>>(0, "parser-results-large-zero-copy", large, depth);
+    run_benchmark<TestLargeProgramZeroCopy<make_parser_with_no_checks>>(0, "parser-no-checks-large-zero-copy", large, depth);
+    run_benchmark<TestLargeProgramZeroCopy<make_parser_with_abort>>(0, "parser-abort-large-zero-copy", large, depth);
+#if defined(PARSER_COROUTINES)
+    run_benchmark<TestLargeProgramZeroCopy<make_parser_with_coroutines>>(0, "parser-coroutines-large-zero-copy", large, depth);
+#endif
+    run_benchmark<TestLargeProgramCAbi<parser_with_exceptions_execute>>(0, "parser-exceptions-large-c-abi", large, depth);
+    run_benchmark<TestLargeProgramCAbi<parser_with_results_execute>>(0, "parser-results-large-c-abi", large, depth);
+    run_memory_benchmark<TestLargeProgramJit>(0, "parser-jit-large", large, depth);
+
+    // ~29 MB, so a hundred-thousandth of the iterations: on one thread, which
+    // is the results engine, and on every core.
+    Options huge = options;
+    huge.iterations = std::max<size_t>(1, options.iterations / 100000);
+    run_benchmark<TestParallelProgram>(0, "parser-threads-huge-1", huge, 22u, 1u);
+    run_benchmark<TestParallelProgram>(0, "parser-threads-huge", huge, 22u, 0u);
     return 0;
 }
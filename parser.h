@@ -0,0 +1,27 @@
+#ifndef CALCULATOR_H
+#define CALCULATOR_H
+
+/* C entry points to the parsers, for callers that hold programs in their own
+ * buffers (mmap'd files, protocol frames) and for other languages. The
+ * program in [program, program + length) doesn't need to be null-terminated.
+ * Like IParser::execute, these return 0 if the program has errors. Unless
+ * error is null, they also store the kind of error in *error, as the value
+ * of the ErrorKind in parser.hpp (0 InvalidOperator, 1 InvalidCharacter,
+ * 2 UnexpectedEOF, 3 DivideByZero, 4 Overflow, 5 UnknownVariable), or -1 if
+ * there is none. */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int64_t parser_with_exceptions_execute(const char* program, size_t length, int* error);
+int64_t parser_with_results_execute(const char* program, size_t length, int* error);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CALCULATOR_H */
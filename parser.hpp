@@ -2,20 +2,151 @@
 #ifndef CALCULATOR_HPP
 #define CALCULATOR_HPP
 
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <string>
+#include <vector>
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
 
-struct IParser {
-    virtual ~IParser() {}
-    virtual int64_t execute(const std::string& program) const = 0;
-};
+#include "parser.h"
+
+// Compilers with C++20 coroutines also build the coroutine engine.
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+#define PARSER_COROUTINES 1
+#endif
 
 enum class ErrorKind {
     InvalidOperator,
     InvalidCharacter,
     UnexpectedEOF,
+    DivideByZero,
+    Overflow,
+    UnknownVariable,
+};
+
+// A program that is compiled once and evaluated many times. Identifiers in
+// it are variables, whose values are bound on every call.
+struct IProgram {
+    virtual ~IProgram() {}
+
+    // Evaluates the program with bindings[i] as the value of the i-th name it
+    // was compiled with; bindings may be null if there are none. Returns 0 if
+    // the program has errors, and stores the kind of error in *error unless
+    // error is null.
+    virtual int64_t execute(const int64_t* bindings, ErrorKind* error) = 0;
+
+    int64_t execute(ErrorKind* error) {
+        return execute(nullptr, error);
+    }
+
+    int64_t execute() {
+        return execute(nullptr, nullptr);
+    }
+
+    // Evaluates the program for many rows at once, with columns[i][r] as the
+    // value of the i-th name in row r. Stores the value of row r in
+    // results[r], or 0 if the row has an error, in which case bit r % 64 of
+    // errors[r / 64] is set; errors has (rows + 63) / 64 words. Uses AVX-512
+    // or AVX2 when the CPU has them.
+    virtual void execute_columns(const int64_t* const* columns, size_t rows, int64_t* results, uint64_t* errors) = 0;
+
+    // The bytes of bytecode and native code the program holds on to.
+    virtual size_t memory_bytes() const = 0;
+};
+
+struct IParser {
+    virtual ~IParser() {}
+
+    // Evaluates the program in [program, program + length), which doesn't
+    // need to be null-terminated. Returns 0 if the program has errors.
+    virtual int64_t execute(const char* program, size_t length) const = 0;
+
+    // The same, storing the kind of error in *error if the program has
+    // errors, unless error is null.
+    virtual int64_t execute(const char* program, size_t length, ErrorKind* error) const = 0;
+
+    // Evaluates the program with arbitrary precision, so that values beyond
+    // int64_t are not an Overflow error. Returns the value in decimal, or an
+    // empty string if the program has errors.
+    virtual std::string execute_big(const char* program, size_t length) const = 0;
+
+    // Compiles a program whose identifiers are variables, to be evaluated
+    // against many bindings of the given names. An identifier that isn't
+    // one of them is an UnknownVariable error. (execute treats identifiers as
+    // invalid operators.)
+    virtual std::unique_ptr<IProgram> compile(const char* program, size_t length,
+                                              const std::vector<std::string>& names) const = 0;
+
+    // One convenience overload per standard, so that a string literal has a
+    // single best match: std::string_view takes std::string, literals and
+    // any other buffer from C++17 on.
+#if __cplusplus >= 201703L
+    int64_t execute(std::string_view program) const {
+        return execute(program.data(), program.size());
+    }
+#else
+    int64_t execute(const std::string& program) const {
+        return execute(program.data(), program.size());
+    }
+#endif
 };
 
 std::unique_ptr<IParser> make_parser_with_exceptions();
 std::unique_ptr<IParser> make_parser_with_results();
 
+// The exceptions engine behind a check, 32 or 64 bytes per instruction where
+// the CPU allows, that every byte is in the grammar and that the parentheses
+// balance. Programs that fail it are parsed by the results engine instead,
+// so stray bytes and unbalanced parentheses never throw.
+std::unique_ptr<IParser> make_parser_with_validation();
+
+// Two reference engines, which say how much of the others' time goes into
+// handling errors, for programs without any. The first has no checks at all:
+// it assumes that programs are valid, and their arithmetic wraps around, so
+// a program with errors is undefined behaviour. The second checks like the
+// others, but stops the process with a trap on the first error. Neither
+// ever reports an error.
+std::unique_ptr<IParser> make_parser_with_no_checks();
+std::unique_ptr<IParser> make_parser_with_abort();
+
+#if defined(PARSER_COROUTINES)
+// Every grammar rule is a coroutine, and co_await propagates errors. Frames
+// come from an arena per thread.
+std::unique_ptr<IParser> make_parser_with_coroutines();
+
+// How many coroutine frames the engine has allocated on this thread.
+uint64_t coroutine_frames_allocated();
+#endif
+
+// Parses the program into bytecode, which is interpreted for the first
+// jit_threshold calls and then compiled to native code. Only x86-64 has a
+// native code tier; elsewhere the bytecode is always interpreted.
+std::unique_ptr<IProgram> make_program_with_jit(const char* program, size_t length, unsigned jit_threshold);
+std::unique_ptr<IProgram> make_program_with_jit(const char* program, size_t length,
+                                                const std::vector<std::string>& names, unsigned jit_threshold);
+
+// Evaluates one very large program on up to threads threads (0 for one per
+// core), with the same value and the same error as make_parser_with_results.
+// The operands of its outer operators are found by a parallel pass over the
+// parentheses, and those in parentheses are evaluated on separate threads.
+// Programs of a few MB or less are evaluated on the calling thread.
+int64_t execute_in_parallel(const char* program, size_t length, ErrorKind* error, unsigned threads);
+
+// The engines parse recursively, with a few stack frames for every '(' and
+// every operator still waiting for its operands, so a program nested deeply
+// enough overflows the stack of the thread that evaluates it. Whether the
+// nesting of the program stays within max_depth levels, found by a scan of
+// its bytes, for turning away untrusted programs before they reach an engine.
+// Identifiers count as operands, as in compiled programs, and the scan only
+// ends early at bytes where every engine stops with an error.
+bool nesting_depth_within(const char* program, size_t length, size_t max_depth);
+
+// The nesting that parser-server and parser-ingest accept: a small part of a
+// thread's stack for any of the engines, and far deeper than any program
+// written by hand.
+const size_t max_nesting_depth = 10000;
+
 #endif // CALCULATOR_HPP
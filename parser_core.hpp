@@ -0,0 +1,1037 @@
+#pragma once
+#ifndef PARSER_CORE_HPP
+#define PARSER_CORE_HPP
+
+#include "parser.hpp"
+#include "big_integer.hpp"
+#include "parser_probes.hpp"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#if __cplusplus >= 202002L
+#include <type_traits>
+#endif
+#if defined(__SSE2__) && !defined(PARSER_NO_SIMD)
+#include <emmintrin.h>
+#define PARSER_SSE2 1
+#endif
+
+// The grammar shared by every engine, parameterised on how errors are
+// handled (see ResultPolicy and ExceptionPolicy) and on whether arithmetic
+// is checked (see CheckedArithmetic and UncheckedArithmetic).
+//
+// From C++20 on, the parser can run in constant expressions with the
+// ResultPolicy, which turns programs that are known at build time into
+// constants (see evaluate_constant below).
+#if __cplusplus >= 202002L
+#define PARSER_CONSTEXPR constexpr
+#else
+#define PARSER_CONSTEXPR inline
+#endif
+
+// The character classes of the grammar, looked up in a table instead of
+// going through the locale machinery of std::isdigit and std::iswspace.
+//
+// Whitespace is exactly ' ' (0x20), '\t' (0x09), '\n' (0x0A), '\v' (0x0B),
+// '\f' (0x0C) and '\r' (0x0D), which is what std::iswspace accepts in the "C"
+// locale. No byte of 0x80 and above is whitespace, so UTF-8 (or any other
+// encoding) is never skipped.
+enum CharClass : unsigned char {
+    CharSpace = 1,
+    CharDigit = 2,
+    CharOperator = 4,
+    CharOpenParen = 8,
+    CharCloseParen = 16,
+    CharLetter = 32,  // starts an identifier: A-Z, a-z and '_'
+};
+
+#define C_N 0
+#define C_S CharSpace
+#define C_D CharDigit
+#define C_O CharOperator
+#define C_L CharOpenParen
+#define C_R CharCloseParen
+#define C_A CharLetter
+constexpr unsigned char char_classes[256] = {
+    C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_S, C_S, C_S, C_S, C_S, C_N, C_N,  // 0x00
+    C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N,  // 0x10
+    C_S, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_L, C_R, C_O, C_O, C_N, C_O, C_N, C_O,  // 0x20
+    C_D, C_D, C_D, C_D, C_D, C_D, C_D, C_D, C_D, C_D, C_N, C_N, C_N, C_N, C_N, C_N,  // 0x30
+    C_N, C_A, C_A, C_A, C_A, C_A, C_A, C_A, C_A, C_A, C_A, C_A, C_A, C_A, C_A, C_A,  // 0x40
+    C_A, C_A, C_A, C_A, C_A, C_A, C_A, C_A, C_A, C_A, C_A, C_N, C_N, C_N, C_N, C_A,  // 0x50
+    C_N, C_A, C_A, C_A, C_A, C_A, C_A, C_A, C_A, C_A, C_A, C_A, C_A, C_A, C_A, C_A,  // 0x60
+    C_A, C_A, C_A, C_A, C_A, C_A, C_A, C_A, C_A, C_A, C_A, C_N, C_N, C_N, C_N, C_N,  // 0x70
+    C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N,  // 0x80
+    C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N,  // 0x90
+    C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N,  // 0xA0
+    C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N,  // 0xB0
+    C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N,  // 0xC0
+    C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N,  // 0xD0
+    C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N,  // 0xE0
+    C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N, C_N,  // 0xF0
+};
+#undef C_N
+#undef C_S
+#undef C_D
+#undef C_O
+#undef C_L
+#undef C_R
+#undef C_A
+
+PARSER_CONSTEXPR bool is_digit(char c) {
+    return char_classes[static_cast<unsigned char>(c)] & CharDigit;
+}
+
+PARSER_CONSTEXPR bool is_space(char c) {
+    return char_classes[static_cast<unsigned char>(c)] & CharSpace;
+}
+
+PARSER_CONSTEXPR bool is_identifier(char c) {
+    return char_classes[static_cast<unsigned char>(c)] & (CharLetter | CharDigit);
+}
+
+PARSER_CONSTEXPR bool in_constant_evaluation() {
+#if __cplusplus >= 202002L
+    return std::is_constant_evaluated();
+#else
+    return false;
+#endif
+}
+
+// Counters of the grammar's hot paths, per thread, for finding out what a
+// benchmark spends its calls on. Only with -DPARSER_COUNTERS: otherwise the
+// macros expand to nothing, and the engines compile to exactly the code they
+// did without them (see scripts/check_codegen.sh).
+#if defined(PARSER_COUNTERS)
+struct ParserCounters {
+    uint64_t get_char;
+    uint64_t peek;
+    uint64_t expression;
+    uint64_t depth;           // of calls to expression, right now
+    uint64_t max_depth;
+    uint64_t errors[6];       // by ErrorKind, where they are raised
+    uint64_t frames_unwound;  // calls to expression left because of errors
+};
+
+inline ParserCounters& parser_counters() {
+    static thread_local ParserCounters counters;
+    return counters;
+}
+
+// Counts a call to expression, and its depth, for as long as it lives.
+struct ExpressionCounter {
+    PARSER_CONSTEXPR ExpressionCounter() {
+        if (!in_constant_evaluation()) {
+            ParserCounters& counters = parser_counters();
+            ++counters.expression;
+            counters.max_depth = std::max(counters.max_depth, ++counters.depth);
+        }
+    }
+
+    PARSER_CONSTEXPR ~ExpressionCounter() {
+        if (!in_constant_evaluation()) {
+            --parser_counters().depth;
+        }
+    }
+};
+
+// Every error goes all the way up, so it leaves every call to expression
+// there is when it is raised.
+inline void count_error(ErrorKind kind) {
+    ParserCounters& counters = parser_counters();
+    ++counters.errors[static_cast<size_t>(kind)];
+    counters.frames_unwound += counters.depth;
+}
+
+#define PARSER_COUNT(counter) (in_constant_evaluation() ? void() : void(++parser_counters().counter))
+#define PARSER_COUNT_EXPRESSION() ExpressionCounter expression_counter
+#define PARSER_COUNT_ERROR(kind) (in_constant_evaluation() ? void() : count_error(kind))
+#else
+#define PARSER_COUNT(counter) ((void)0)
+#define PARSER_COUNT_EXPRESSION() ((void)0)
+#define PARSER_COUNT_ERROR(kind) ((void)0)
+#endif
+
+// The static tracepoints of parser_probes.hpp, which have no place in
+// constant evaluation.
+#if defined(PARSER_HAS_PROBES)
+__attribute__((always_inline)) inline void probe_execute_entry(const char* program, size_t length) {
+    PARSER_PROBE2(execute__entry, program, length);
+}
+
+__attribute__((always_inline)) inline void probe_execute_return(int64_t value, int error) {
+    PARSER_PROBE2(execute__return, value, error);
+}
+
+__attribute__((always_inline)) inline void probe_error(int error, int throws) {
+    PARSER_PROBE2(error, error, throws);
+}
+
+#define PARSER_PROBE_EXECUTE_ENTRY(program, length) \
+    (in_constant_evaluation() ? void() : probe_execute_entry(program, length))
+#define PARSER_PROBE_EXECUTE_RETURN(result) \
+    (in_constant_evaluation() ? void() \
+                              : probe_execute_return(result.is_error ? 0 : result.ok, \
+                                                     result.is_error ? static_cast<int>(result.error) : -1))
+#define PARSER_PROBE_ERROR(ErrorPolicy, kind) \
+    (in_constant_evaluation() || !raises_errors<ErrorPolicy>::value \
+         ? void() \
+         : probe_error(static_cast<int>(kind), std::is_same<ErrorPolicy, ExceptionPolicy>::value))
+#else
+#define PARSER_PROBE_EXECUTE_ENTRY(program, length) ((void)0)
+#define PARSER_PROBE_EXECUTE_RETURN(result) ((void)0)
+#define PARSER_PROBE_ERROR(ErrorPolicy, kind) ((void)0)
+#endif
+
+// Numbers are read 8 digits at a time with SWAR (SIMD within a register),
+// which needs little-endian loads. Define PARSER_NO_SWAR to compare against
+// the plain digit-by-digit loop.
+#if !defined(PARSER_NO_SWAR) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define PARSER_SWAR 1
+#endif
+
+#if defined(PARSER_SWAR)
+inline uint64_t power_of_ten(unsigned n) {
+    static const uint64_t powers[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000};
+    return powers[n];
+}
+
+// Finds the run of digits at the start of the 8 bytes at p and stores its
+// value in value. Returns the number of digits (0 to 8).
+inline unsigned parse_eight_digits(const char* p, uint64_t& value) {
+    uint64_t chunk;
+    std::memcpy(&chunk, p, 8);
+
+    // '0'..'9' become 0..9. A byte is a digit if its high nibble is now 0 and
+    // its low nibble is at most 9, i.e. adding 6 doesn't carry into bit 4.
+    uint64_t digits = chunk ^ 0x3030303030303030;
+    uint64_t non_digits = (digits & 0xF0F0F0F0F0F0F0F0)
+                        | (((digits & 0x0F0F0F0F0F0F0F0F) + 0x0606060606060606) & 0x1010101010101010);
+    unsigned count = non_digits ? __builtin_ctzll(non_digits) / 8 : 8;
+    if (count == 0) {
+        value = 0;
+        return 0;
+    }
+
+    // Move the digits to the top, so that the bytes below become leading
+    // zeros, then combine pairs, quads and octets of digits.
+    digits <<= 8 * (8 - count);
+    digits = digits * 10 + (digits >> 8);
+    digits = (((digits & 0x000000FF000000FF) * 0x000F424000000064)
+            + (((digits >> 16) & 0x000000FF000000FF) * 0x0000271000000001)) >> 32;
+    value = digits;
+    return count;
+}
+#endif
+
+#if defined(PARSER_SSE2)
+// Returns the number of whitespace bytes at the start of the 16 bytes at p.
+// Define PARSER_NO_SIMD to skip whitespace one byte at a time instead.
+inline unsigned count_whitespace_16(const char* p) {
+    __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    __m128i space = _mm_cmpeq_epi8(bytes, _mm_set1_epi8(' '));
+    // '\t'..'\r' are moved to -128..-124, the only bytes below -123.
+    __m128i control = _mm_cmplt_epi8(_mm_add_epi8(bytes, _mm_set1_epi8(0x77)), _mm_set1_epi8(-123));
+    unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_or_si128(space, control)));
+    return static_cast<unsigned>(__builtin_ctz(~mask | 0x10000));
+}
+#endif
+
+// Sets bit i of opens if p[i] is '(', and of closes if it is ')', for the 64
+// bytes at p.
+inline void find_parens_64(const char* p, uint64_t& opens, uint64_t& closes) {
+    opens = 0;
+    closes = 0;
+#if defined(PARSER_SSE2)
+    for (unsigned i = 0; i < 64; i += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        opens |= uint64_t{static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('('))))} << i;
+        closes |= uint64_t{static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(')'))))} << i;
+    }
+#else
+    for (unsigned i = 0; i < 64; ++i) {
+        opens |= uint64_t{p[i] == '('} << i;
+        closes |= uint64_t{p[i] == ')'} << i;
+    }
+#endif
+}
+
+template <class T>
+struct Result {
+    union {
+        T ok;
+        ErrorKind error;
+    };
+    bool is_error;
+
+    explicit PARSER_CONSTEXPR Result(T ok) : ok(ok), is_error(false) {}
+    explicit PARSER_CONSTEXPR Result(ErrorKind error) : error(error), is_error(true) {}
+};
+
+enum class Op {
+    Add,
+    Sub,
+    Mul,
+    Div,
+};
+
+// An error policy decides how the parser raises, propagates and checks
+// errors:
+//
+//   result<T>           what a grammar rule returns
+//   ok(value)           returns a value from a rule
+//   fail<T>(kind)       raises an error from a rule returning result<T>
+//   is_error(r)         whether a rule failed, checked after every call
+//   error(r), value(r)  the error or the value of a result
+//   catch_errors<T>(f)  runs a whole parse, returning its outcome as a Result
+//
+// A new error handling strategy is a new policy; the grammar is shared.
+
+// Errors are returned in a Result<T> and checked after every call.
+struct ResultPolicy {
+    template <class T>
+    using result = Result<T>;
+
+    template <class T>
+    static PARSER_CONSTEXPR Result<T> ok(T value) { return Result<T>{value}; }
+
+    template <class T>
+    static PARSER_CONSTEXPR Result<T> fail(ErrorKind kind) { return Result<T>{kind}; }
+
+    template <class T>
+    static PARSER_CONSTEXPR bool is_error(const Result<T>& r) { return r.is_error; }
+
+    template <class T>
+    static PARSER_CONSTEXPR ErrorKind error(const Result<T>& r) { return r.error; }
+
+    template <class T>
+    static PARSER_CONSTEXPR T value(const Result<T>& r) { return r.ok; }
+
+    template <class T, class F>
+    static PARSER_CONSTEXPR Result<T> catch_errors(F parse) { return parse(); }
+};
+
+// Errors are thrown, and rules return plain values. is_error is always false,
+// so the checks in the grammar compile away.
+struct ExceptionPolicy {
+    struct Error {
+        ErrorKind kind;
+
+        Error(ErrorKind kind) : kind(kind) {}
+    };
+
+    template <class T>
+    using result = T;
+
+    template <class T>
+    static PARSER_CONSTEXPR T ok(T value) { return value; }
+
+    template <class T>
+    [[noreturn]] static T fail(ErrorKind kind) { throw Error{kind}; }
+
+    template <class T>
+    static PARSER_CONSTEXPR bool is_error(const T&) { return false; }
+
+    template <class T>
+    static PARSER_CONSTEXPR ErrorKind error(const T&) { return ErrorKind{}; }
+
+    template <class T>
+    static PARSER_CONSTEXPR T value(T value) { return value; }
+
+    template <class T, class F>
+    static Result<T> catch_errors(F parse) {
+        try {
+            return Result<T>{parse()};
+        }
+        catch (const Error& err) {
+            return Result<T>{err.kind};
+        }
+    }
+};
+
+// The two reference engines (see make_parser_with_no_checks and
+// make_parser_with_abort in parser.hpp) don't report errors at all. Like the
+// ExceptionPolicy, their rules return plain values and is_error is always
+// false, so the grammar's checks after every call compile away; what is left
+// is what fail does.
+
+// Programs are assumed to be valid, so no error is ever raised: the compiler
+// may drop every check that would lead to one. A program with errors is
+// undefined behaviour.
+struct UncheckedPolicy {
+    template <class T>
+    using result = T;
+
+    template <class T>
+    static PARSER_CONSTEXPR T ok(T value) { return value; }
+
+    template <class T>
+    [[noreturn]] static T fail(ErrorKind) { __builtin_unreachable(); }
+
+    template <class T>
+    static PARSER_CONSTEXPR bool is_error(const T&) { return false; }
+
+    template <class T>
+    static PARSER_CONSTEXPR ErrorKind error(const T&) { return ErrorKind{}; }
+
+    template <class T>
+    static PARSER_CONSTEXPR T value(T value) { return value; }
+
+    template <class T, class F>
+    static PARSER_CONSTEXPR Result<T> catch_errors(F parse) { return Result<T>{parse()}; }
+};
+
+// Whether a policy raises errors at all. Nothing that comes before raising
+// one, such as a probe, may stay behind when it doesn't: that would keep
+// alive the checks that lead to it.
+template <class ErrorPolicy>
+struct raises_errors {
+    static constexpr bool value = true;
+};
+
+template <>
+struct raises_errors<UncheckedPolicy> {
+    static constexpr bool value = false;
+};
+
+// The checks stay, but an error stops the process with a trap instruction,
+// which is the cheapest way to not return. Like a throw, it is called out of
+// line and kept apart from the hot code.
+struct AbortPolicy {
+    template <class T>
+    using result = T;
+
+    template <class T>
+    static PARSER_CONSTEXPR T ok(T value) { return value; }
+
+    template <class T>
+    [[noreturn]] __attribute__((cold, noinline)) static T fail(ErrorKind) { __builtin_trap(); }
+
+    template <class T>
+    static PARSER_CONSTEXPR bool is_error(const T&) { return false; }
+
+    template <class T>
+    static PARSER_CONSTEXPR ErrorKind error(const T&) { return ErrorKind{}; }
+
+    template <class T>
+    static PARSER_CONSTEXPR T value(T value) { return value; }
+
+    template <class T, class F>
+    static PARSER_CONSTEXPR Result<T> catch_errors(F parse) { return Result<T>{parse()}; }
+};
+
+// An arithmetic policy decides what a Value is, and computes r = a op b,
+// returning true if the result overflows. append_digits(n, scale, digits)
+// computes n = n * scale + digits for number literals. divide_by_zero(b) says
+// whether to reject a division. Identifiers are only parsed if has_variables
+// is set; variable(begin, end, r) then looks one up, returning true if it is
+// unknown.
+
+// Every overflow and division by zero is an error. This is what the engines
+// use.
+struct CheckedArithmetic {
+    using Value = int64_t;
+
+    static constexpr bool has_variables = false;
+
+    static PARSER_CONSTEXPR bool variable(const char*, const char*, int64_t&) { return true; }
+
+    static PARSER_CONSTEXPR bool add(int64_t a, int64_t b, int64_t& r) { return __builtin_add_overflow(a, b, &r); }
+    static PARSER_CONSTEXPR bool sub(int64_t a, int64_t b, int64_t& r) { return __builtin_sub_overflow(a, b, &r); }
+    static PARSER_CONSTEXPR bool mul(int64_t a, int64_t b, int64_t& r) { return __builtin_mul_overflow(a, b, &r); }
+
+    static PARSER_CONSTEXPR bool div(int64_t a, int64_t b, int64_t& r) {
+        if (a == INT64_MIN && b == -1) {
+            return true;
+        }
+        r = a / b;
+        return false;
+    }
+
+    static PARSER_CONSTEXPR bool append_digits(int64_t& n, int64_t scale, int64_t digits) {
+        return __builtin_mul_overflow(n, scale, &n) || __builtin_add_overflow(n, digits, &n);
+    }
+
+    static PARSER_CONSTEXPR bool divide_by_zero(int64_t b) { return b == 0; }
+};
+
+// No checks: addition, subtraction and multiplication wrap around, and
+// dividing by zero (or INT64_MIN by -1) is undefined. Only for measuring what
+// the checks cost, on programs known to be free of arithmetic errors.
+struct UncheckedArithmetic {
+    using Value = int64_t;
+
+    static constexpr bool has_variables = false;
+
+    static PARSER_CONSTEXPR bool variable(const char*, const char*, int64_t&) { return true; }
+
+    static PARSER_CONSTEXPR bool add(int64_t a, int64_t b, int64_t& r) {
+        r = static_cast<int64_t>(static_cast<uint64_t>(a) + static_cast<uint64_t>(b));
+        return false;
+    }
+
+    static PARSER_CONSTEXPR bool sub(int64_t a, int64_t b, int64_t& r) {
+        r = static_cast<int64_t>(static_cast<uint64_t>(a) - static_cast<uint64_t>(b));
+        return false;
+    }
+
+    static PARSER_CONSTEXPR bool mul(int64_t a, int64_t b, int64_t& r) {
+        r = static_cast<int64_t>(static_cast<uint64_t>(a) * static_cast<uint64_t>(b));
+        return false;
+    }
+
+    static PARSER_CONSTEXPR bool div(int64_t a, int64_t b, int64_t& r) {
+        r = a / b;
+        return false;
+    }
+
+    static PARSER_CONSTEXPR bool append_digits(int64_t& n, int64_t scale, int64_t digits) {
+        return mul(n, scale, n) || add(n, digits, n);
+    }
+
+    static PARSER_CONSTEXPR bool divide_by_zero(int64_t) { return false; }
+};
+
+// Arbitrary precision: a value stays in an int64_t until a result overflows
+// it, and only then moves to limbs in the arena (see big_integer.hpp). Nothing
+// overflows; division by zero is still an error.
+struct BigArithmetic {
+    using Value = BigValue;
+
+    static constexpr bool has_variables = false;
+
+    static bool variable(const char*, const char*, BigValue&) { return true; }
+
+    BigArena* arena;
+
+    bool add(const BigValue& a, const BigValue& b, BigValue& r) const {
+        int64_t small;
+        if (a.is_small() && b.is_small() && !__builtin_add_overflow(a.small, b.small, &small)) {
+            r = BigValue{small, nullptr, 0, false};
+        } else {
+            r = big_add(*arena, a, b, false);
+        }
+        return false;
+    }
+
+    bool sub(const BigValue& a, const BigValue& b, BigValue& r) const {
+        int64_t small;
+        if (a.is_small() && b.is_small() && !__builtin_sub_overflow(a.small, b.small, &small)) {
+            r = BigValue{small, nullptr, 0, false};
+        } else {
+            r = big_add(*arena, a, b, true);
+        }
+        return false;
+    }
+
+    bool mul(const BigValue& a, const BigValue& b, BigValue& r) const {
+        int64_t small;
+        if (a.is_small() && b.is_small() && !__builtin_mul_overflow(a.small, b.small, &small)) {
+            r = BigValue{small, nullptr, 0, false};
+        } else {
+            r = big_multiply(*arena, a, b);
+        }
+        return false;
+    }
+
+    bool div(const BigValue& a, const BigValue& b, BigValue& r) const {
+        if (a.is_small() && b.is_small() && !(a.small == INT64_MIN && b.small == -1)) {
+            r = BigValue{a.small / b.small, nullptr, 0, false};
+        } else {
+            r = big_divide(*arena, a, b);
+        }
+        return false;
+    }
+
+    bool append_digits(BigValue& n, int64_t scale, int64_t digits) const {
+        int64_t small;
+        if (n.is_small() && !__builtin_mul_overflow(n.small, scale, &small)
+                && !__builtin_add_overflow(small, digits, &small)) {
+            n = BigValue{small, nullptr, 0, false};
+        } else {
+            BigValue shifted = big_multiply(*arena, n, BigValue{scale, nullptr, 0, false});
+            n = big_add(*arena, shifted, BigValue{digits, nullptr, 0, false}, false);
+        }
+        return false;
+    }
+
+    static bool divide_by_zero(const BigValue& b) { return b.is_small() && b.small == 0; }
+};
+
+template <class ErrorPolicy, class Arithmetic = CheckedArithmetic>
+struct Parser {
+    template <class T>
+    using result = typename ErrorPolicy::template result<T>;
+    using Value = typename Arithmetic::Value;
+
+    const char* p;
+    const char* end;
+    Arithmetic arithmetic;
+
+    PARSER_CONSTEXPR Parser(const char* begin, const char* end, Arithmetic arithmetic = Arithmetic{})
+        : p(begin), end(end), arithmetic(arithmetic) {}
+
+    template <class T>
+    static PARSER_CONSTEXPR result<T> ok(T value) { return ErrorPolicy::template ok<T>(value); }
+
+    template <class T>
+    static PARSER_CONSTEXPR result<T> fail(ErrorKind kind) {
+        PARSER_COUNT_ERROR(kind);
+        PARSER_PROBE_ERROR(ErrorPolicy, kind);
+        return ErrorPolicy::template fail<T>(kind);
+    }
+
+    // Passes on an error that a rule called has raised.
+    template <class T>
+    static PARSER_CONSTEXPR result<T> forward(ErrorKind kind) { return ErrorPolicy::template fail<T>(kind); }
+
+    template <class R>
+    static PARSER_CONSTEXPR bool is_error(const R& r) { return ErrorPolicy::is_error(r); }
+
+    template <class R>
+    static PARSER_CONSTEXPR ErrorKind error(const R& r) { return ErrorPolicy::error(r); }
+
+    template <class R>
+    static PARSER_CONSTEXPR auto value(const R& r) -> decltype(ErrorPolicy::value(r)) { return ErrorPolicy::value(r); }
+
+    PARSER_CONSTEXPR result<Value> inner_expression() {
+        result<Op> op = operation();
+        if (is_error(op)) {
+            return forward<Value>(error(op));
+        }
+        result<Value> left = expression();
+        if (is_error(left)) {
+            return left;
+        }
+        result<Value> right = expression();
+        if (is_error(right)) {
+            return right;
+        }
+
+        Value n = Value{};
+        bool overflow = false;
+        switch (value(op)) {
+            case Op::Add: overflow = arithmetic.add(value(left), value(right), n); break;
+            case Op::Sub: overflow = arithmetic.sub(value(left), value(right), n); break;
+            case Op::Mul: overflow = arithmetic.mul(value(left), value(right), n); break;
+            case Op::Div:
+                if (arithmetic.divide_by_zero(value(right))) {
+                    return fail<Value>(ErrorKind::DivideByZero);
+                }
+                overflow = arithmetic.div(value(left), value(right), n);
+                break;
+            default: return fail<Value>(ErrorKind::InvalidOperator);
+        }
+        if (overflow) {
+            return fail<Value>(ErrorKind::Overflow);
+        }
+        return ok<Value>(n);
+    }
+
+    PARSER_CONSTEXPR result<Value> expression() {
+        PARSER_COUNT_EXPRESSION();
+        skip_whitespace();
+        char c = peek();
+        if (c == '(') {
+            get_char();
+            skip_whitespace();
+            result<Value> val = expression();
+            if (is_error(val)) {
+                return val;
+            }
+            skip_whitespace();
+            result<char> x = expect_char(')');
+            if (is_error(x)) {
+                return forward<Value>(error(x));
+            }
+            return val;
+        } else if (c >= '0' && c <= '9') {
+            return number();
+        } else if (Arithmetic::has_variables && (char_classes[static_cast<unsigned char>(c)] & CharLetter)) {
+            return variable();
+        } else {
+            return inner_expression();
+        }
+    }
+
+    PARSER_CONSTEXPR result<Op> operation() {
+        result<char> c = get_char();
+        if (is_error(c)) {
+            return forward<Op>(error(c));
+        }
+
+        switch (value(c)) {
+            case '+': return ok<Op>(Op::Add);
+            case '-': return ok<Op>(Op::Sub);
+            case '*': return ok<Op>(Op::Mul);
+            case '/': return ok<Op>(Op::Div);
+            default:  return fail<Op>(ErrorKind::InvalidOperator);
+        }
+    }
+
+    PARSER_CONSTEXPR result<Value> number() {
+        Value n = Value{};
+#if defined(PARSER_SWAR)
+        // Fast path for numbers of more than two digits, until fewer than 8
+        // bytes are left. Shorter numbers are quicker to read one by one.
+        if (!in_constant_evaluation() && end - p >= 8 && is_digit(p[1]) && is_digit(p[2])) {
+            uint64_t chunk = 0;
+            while (end - p >= 8) {
+                unsigned count = parse_eight_digits(p, chunk);
+                if (arithmetic.append_digits(n, static_cast<int64_t>(power_of_ten(count)), static_cast<int64_t>(chunk))) {
+                    return fail<Value>(ErrorKind::Overflow);
+                }
+                p += count;
+                if (count < 8) {
+                    break;
+                }
+            }
+        }
+#endif
+        while (is_digit(peek())) {
+            result<char> c = get_char();
+            if (is_error(c)) {
+                return forward<Value>(error(c));
+            }
+
+            if (arithmetic.append_digits(n, 10, value(c) - '0')) {
+                return fail<Value>(ErrorKind::Overflow);
+            }
+        }
+        return ok<Value>(n);
+    }
+
+    PARSER_CONSTEXPR result<Value> variable() {
+        const char* begin = p;
+        while (is_identifier(peek())) {
+            get_char();
+        }
+        Value v = Value{};
+        if (arithmetic.variable(begin, p, v)) {
+            return fail<Value>(ErrorKind::UnknownVariable);
+        }
+        return ok<Value>(v);
+    }
+
+    PARSER_CONSTEXPR result<char> expect_char(char c) {
+        result<char> x = get_char();
+        if (is_error(x)) {
+            return x;
+        }
+        if (value(x) != c) {
+            return fail<char>(ErrorKind::InvalidCharacter);
+        }
+        return x;
+    }
+
+    PARSER_CONSTEXPR result<char> get_char() {
+        PARSER_COUNT(get_char);
+        if (p == end) {
+            return fail<char>(ErrorKind::UnexpectedEOF);
+        }
+        return ok<char>(*p++);
+    }
+
+    PARSER_CONSTEXPR char peek() {
+        PARSER_COUNT(peek);
+        if (p == end) {
+            return 0;
+        }
+        return *p;
+    }
+
+    PARSER_CONSTEXPR void skip_whitespace() {
+#if defined(PARSER_SSE2)
+        // Long runs, such as indentation, 16 bytes at a time.
+        if (!in_constant_evaluation()) {
+            while (end - p >= 16 && is_space(p[0]) && is_space(p[1])) {
+                unsigned count = count_whitespace_16(p);
+                p += count;
+                if (count < 16) {
+                    break;
+                }
+            }
+        }
+#endif
+        while (is_space(peek())) {
+            get_char();
+        }
+    }
+};
+
+// Parses and evaluates the program in [begin, end) with the given error and
+// arithmetic policies.
+template <class ErrorPolicy, class Arithmetic = CheckedArithmetic>
+PARSER_CONSTEXPR Result<typename Arithmetic::Value> evaluate(const char* begin, const char* end,
+                                                            Arithmetic arithmetic = Arithmetic{}) {
+    Parser<ErrorPolicy, Arithmetic> parser{begin, end, arithmetic};
+    return ErrorPolicy::template catch_errors<typename Arithmetic::Value>([&]() { return parser.expression(); });
+}
+
+// What IParser::execute does for an engine, without the virtual call: the
+// value of the program, or 0 if it has errors, whose kind the second overload
+// stores in *error unless error is null.
+template <class ErrorPolicy, class Arithmetic = CheckedArithmetic>
+PARSER_CONSTEXPR int64_t execute_program(const char* program, size_t length) {
+    PARSER_PROBE_EXECUTE_ENTRY(program, length);
+    Result<int64_t> result = evaluate<ErrorPolicy, Arithmetic>(program, program + length);
+    PARSER_PROBE_EXECUTE_RETURN(result);
+    if (result.is_error) {
+        return 0;
+    } else {
+        return result.ok;
+    }
+}
+
+template <class ErrorPolicy, class Arithmetic = CheckedArithmetic>
+PARSER_CONSTEXPR int64_t execute_program(const char* program, size_t length, ErrorKind* error) {
+    PARSER_PROBE_EXECUTE_ENTRY(program, length);
+    Result<int64_t> result = evaluate<ErrorPolicy, Arithmetic>(program, program + length);
+    PARSER_PROBE_EXECUTE_RETURN(result);
+    if (result.is_error) {
+        if (error) {
+            *error = result.error;
+        }
+        return 0;
+    } else {
+        return result.ok;
+    }
+}
+
+// What IParser::execute_big does for an engine: the value of the program in
+// decimal, with arbitrary precision, or an empty string if it has errors.
+template <class ErrorPolicy>
+std::string execute_big_program(const char* program, size_t length) {
+    BigArena arena;
+    Result<BigValue> result = evaluate<ErrorPolicy, BigArithmetic>(program, program + length, BigArithmetic{&arena});
+    if (result.is_error) {
+        return std::string{};
+    } else {
+        return to_decimal(result.ok);
+    }
+}
+
+// Programs compiled once (IParser::compile, make_program_with_jit) become a
+// postfix bytecode for a stack machine, so that evaluating them again doesn't
+// scan the text.
+enum class Opcode : uint8_t {
+    Push,
+    Load,
+    Add,
+    Sub,
+    Mul,
+    Div,
+};
+
+struct Instruction {
+    Opcode opcode;
+    int64_t operand;  // the constant for Push, the index of the binding for Load
+};
+
+// An arithmetic policy that appends the bytecode of every operation instead
+// of computing it. The grammar visits operands before their operator, so the
+// bytecode comes out in postfix order. A Value is one past the index of the
+// instruction that produces it, or 0 for a number that has no digits yet.
+struct BytecodeBuilder {
+    using Value = uint32_t;
+
+    static constexpr bool has_variables = true;
+
+    std::vector<Instruction>* code;
+    const std::vector<std::string>* names;
+
+    Value emit(Opcode opcode, int64_t operand) const {
+        code->push_back(Instruction{opcode, operand});
+        return static_cast<Value>(code->size());
+    }
+
+    bool add(Value, Value, Value& r) const { r = emit(Opcode::Add, 0); return false; }
+    bool sub(Value, Value, Value& r) const { r = emit(Opcode::Sub, 0); return false; }
+    bool mul(Value, Value, Value& r) const { r = emit(Opcode::Mul, 0); return false; }
+    bool div(Value, Value, Value& r) const { r = emit(Opcode::Div, 0); return false; }
+
+    // Literals are still folded here, so that a literal too large for int64_t
+    // is an Overflow error before the program ever runs, like in the engines.
+    bool append_digits(Value& n, int64_t scale, int64_t digits) const {
+        if (n == 0) {
+            n = emit(Opcode::Push, 0);
+        }
+        return CheckedArithmetic::append_digits((*code)[n - 1].operand, scale, digits);
+    }
+
+    bool variable(const char* begin, const char* end, Value& r) const {
+        for (size_t i = 0; i < names->size(); ++i) {
+            const std::string& name = (*names)[i];
+            if (name.size() == static_cast<size_t>(end - begin) && name.compare(0, name.size(), begin, name.size()) == 0) {
+                r = emit(Opcode::Load, static_cast<int64_t>(i));
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Checked when the program runs.
+    static bool divide_by_zero(Value) { return false; }
+};
+
+// A program compiled to bytecode. If it has errors that don't depend on the
+// bindings, code is empty, and error is the outcome of every call.
+struct Bytecode {
+    std::vector<Instruction> code;
+    size_t stack_depth = 0;
+    ErrorKind error = ErrorKind::UnexpectedEOF;
+
+    Bytecode(const char* program, size_t length, const std::vector<std::string>& names) {
+        Result<uint32_t> parsed = evaluate<ResultPolicy, BytecodeBuilder>(program, program + length,
+                                                                         BytecodeBuilder{&code, &names});
+        if (parsed.is_error) {
+            code.clear();
+            error = parsed.error;
+            // Without variables, the engines compute as they parse, so an
+            // arithmetic error can come before a syntax error: let them say
+            // which is first.
+            if (names.empty()) {
+                error = evaluate<ResultPolicy>(program, program + length).error;
+            }
+            return;
+        }
+
+        code.shrink_to_fit();
+        size_t depth = 0;
+        for (const Instruction& instruction : code) {
+            if (instruction.opcode == Opcode::Push || instruction.opcode == Opcode::Load) {
+                stack_depth = std::max(stack_depth, ++depth);
+            } else {
+                --depth;
+            }
+        }
+    }
+
+    size_t memory_bytes() const {
+        return code.capacity() * sizeof(Instruction);
+    }
+};
+
+// Runs bytecode on a stack of at least Bytecode::stack_depth values, raising
+// arithmetic errors with the given error policy.
+template <class ErrorPolicy>
+typename ErrorPolicy::template result<int64_t> run_bytecode(const std::vector<Instruction>& code, int64_t* stack,
+                                                            const int64_t* bindings) {
+    int64_t* top = stack;
+    for (const Instruction& instruction : code) {
+        switch (instruction.opcode) {
+            case Opcode::Push: *top++ = instruction.operand; continue;
+            case Opcode::Load: *top++ = bindings[instruction.operand]; continue;
+            default: break;
+        }
+
+        int64_t right = *--top;
+        int64_t left = top[-1];
+        bool overflow = false;
+        switch (instruction.opcode) {
+            case Opcode::Add: overflow = CheckedArithmetic::add(left, right, top[-1]); break;
+            case Opcode::Sub: overflow = CheckedArithmetic::sub(left, right, top[-1]); break;
+            case Opcode::Mul: overflow = CheckedArithmetic::mul(left, right, top[-1]); break;
+            case Opcode::Div:
+                if (CheckedArithmetic::divide_by_zero(right)) {
+                    PARSER_PROBE_ERROR(ErrorPolicy, ErrorKind::DivideByZero);
+                    return ErrorPolicy::template fail<int64_t>(ErrorKind::DivideByZero);
+                }
+                overflow = CheckedArithmetic::div(left, right, top[-1]);
+                break;
+            default: break;
+        }
+        if (overflow) {
+            PARSER_PROBE_ERROR(ErrorPolicy, ErrorKind::Overflow);
+            return ErrorPolicy::template fail<int64_t>(ErrorKind::Overflow);
+        }
+    }
+    return ErrorPolicy::template ok<int64_t>(stack[0]);
+}
+
+// Evaluation of bytecode over columns of bindings (see
+// IProgram::execute_columns), in blocks of rows, one opcode at a time.
+// Addition and subtraction run on 4 (AVX2) or 8 (AVX-512) lanes at once;
+// multiplication and division are checked lane by lane.
+enum class ColumnIsa {
+    Scalar,
+    Avx2,
+    Avx512,
+};
+
+bool column_isa_supported(ColumnIsa isa);
+ColumnIsa best_column_isa();
+void execute_bytecode_columns(const Bytecode& bytecode, ColumnIsa isa, const int64_t* const* columns, size_t rows,
+                              int64_t* results, uint64_t* errors);
+
+// What IParser::compile returns for an engine.
+template <class ErrorPolicy>
+struct CompiledProgram : IProgram {
+    using IProgram::execute;
+
+    Bytecode bytecode;
+    std::vector<int64_t> stack;
+
+    CompiledProgram(const char* program, size_t length, const std::vector<std::string>& names)
+        : bytecode(program, length, names), stack(bytecode.stack_depth) {}
+
+    int64_t execute(const int64_t* bindings, ErrorKind* error) final {
+        if (bytecode.code.empty()) {
+            if (error) {
+                *error = bytecode.error;
+            }
+            return 0;
+        }
+        Result<int64_t> result = ErrorPolicy::template catch_errors<int64_t>([&]() {
+            return run_bytecode<ErrorPolicy>(bytecode.code, stack.data(), bindings);
+        });
+        if (result.is_error) {
+            if (error) {
+                *error = result.error;
+            }
+            return 0;
+        } else {
+            return result.ok;
+        }
+    }
+
+    void execute_columns(const int64_t* const* columns, size_t rows, int64_t* results, uint64_t* errors) final {
+        execute_bytecode_columns(bytecode, best_column_isa(), columns, rows, results, errors);
+    }
+
+    size_t memory_bytes() const final {
+        return bytecode.memory_bytes() + stack.capacity() * sizeof(int64_t);
+    }
+};
+
+#if __cplusplus >= 202002L
+// Deliberately not constexpr: reaching one of them from evaluate_constant
+// makes the program a compile error, whose diagnostic names the error.
+inline void invalid_operator_in_constant_program() {}
+inline void invalid_character_in_constant_program() {}
+inline void unexpected_eof_in_constant_program() {}
+inline void divide_by_zero_in_constant_program() {}
+inline void overflow_in_constant_program() {}
+inline void unknown_variable_in_constant_program() {}
+
+// Evaluates a program at compile time. Exceptions can't be thrown in constant
+// evaluation, so errors come back through the Result path and are turned into
+// compile errors here.
+template <size_t N>
+consteval int64_t evaluate_constant(const char (&program)[N]) {
+    Result<int64_t> result = evaluate<ResultPolicy>(program, program + N - 1);
+    if (result.is_error) {
+        switch (result.error) {
+            case ErrorKind::InvalidOperator: invalid_operator_in_constant_program(); break;
+            case ErrorKind::InvalidCharacter: invalid_character_in_constant_program(); break;
+            case ErrorKind::UnexpectedEOF: unexpected_eof_in_constant_program(); break;
+            case ErrorKind::DivideByZero: divide_by_zero_in_constant_program(); break;
+            case ErrorKind::Overflow: overflow_in_constant_program(); break;
+            case ErrorKind::UnknownVariable: unknown_variable_in_constant_program(); break;
+        }
+    }
+    return result.ok;
+}
+#endif
+
+#endif // PARSER_CORE_HPP
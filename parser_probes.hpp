@@ -0,0 +1,86 @@
+#pragma once
+#ifndef PARSER_PROBES_HPP
+#define PARSER_PROBES_HPP
+
+#include <type_traits>
+
+// Static tracepoints (USDT probes, in the format of SystemTap's <sys/sdt.h>)
+// for attaching bpftrace, perf or SystemTap to a running process, e.g.
+//
+//   bpftrace -e 'usdt:./parser-server:parser:error { @[arg0] = count(); }'
+//
+// A probe is a single nop at the point of the probe, plus a note in the ELF
+// file that says where the nop is and where to find the arguments: in
+// registers or memory that hold them anyway. Until a tracer replaces the nop
+// with a breakpoint, nothing happens. The probes are:
+//
+//   parser:execute__entry  (const char* program, size_t length)
+//   parser:execute__return (int64_t value, int error)
+//   parser:error           (int error, int throws)
+//
+// where error is an ErrorKind, or -1 for none, and throws is 1 where the
+// ExceptionPolicy throws the error and 0 where the ResultPolicy returns it
+// (or the AbortPolicy traps). The UncheckedPolicy raises no errors.
+// See scripts/*.bt for examples.
+//
+// The probes are only compiled in with PARSER_PROBES defined (CMake option
+// EVR_PROBES for the benchmarks; the profile build, parser-server and
+// parser-ingest always have them), since the nops and the registers that
+// hold their arguments change the code of the engines being compared.
+// Without <sys/sdt.h>, the notes are written here, for x86-64 and AArch64.
+#if defined(PARSER_PROBES)
+#if defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#define PARSER_SDT_HEADER 1
+#endif
+#endif
+
+#if defined(PARSER_SDT_HEADER)
+#include <sys/sdt.h>
+#define PARSER_PROBE2(name, first, second) STAP_PROBE2(parser, name, first, second)
+#define PARSER_HAS_PROBES 1
+#elif defined(__GNUC__) && defined(__ELF__) && (defined(__x86_64__) || defined(__aarch64__))
+// The note of a probe, as <sys/sdt.h> writes it: its address, the address of
+// _.stapsdt.base (which tells the tracer how far the file was moved when it
+// was loaded), no semaphore, the provider, the name and the arguments. The
+// "?" flag puts the note in the same section group as the function, so that
+// it goes away with it when the linker drops the function.
+#define PARSER_PROBE_NOTE(name, arguments) \
+    "990: nop\n" \
+    ".pushsection .note.stapsdt,\"?\",\"note\"\n" \
+    ".balign 4\n" \
+    ".4byte 992f-991f, 994f-993f, 3\n" \
+    "991: .asciz \"stapsdt\"\n" \
+    "992: .balign 4\n" \
+    "993: .8byte 990b\n" \
+    ".8byte _.stapsdt.base\n" \
+    ".8byte 0\n" \
+    ".asciz \"parser\"\n" \
+    ".asciz \"" #name "\"\n" \
+    ".asciz \"" arguments "\"\n" \
+    "994: .balign 4\n" \
+    ".popsection\n" \
+    ".ifndef _.stapsdt.base\n" \
+    ".pushsection .stapsdt.base,\"aG\",\"progbits\",.stapsdt.base,comdat\n" \
+    ".weak _.stapsdt.base\n" \
+    ".hidden _.stapsdt.base\n" \
+    "_.stapsdt.base: .space 1\n" \
+    ".size _.stapsdt.base, 1\n" \
+    ".popsection\n" \
+    ".endif\n"
+
+// An argument is described as size@location, with a negative size for
+// signed types, e.g. "-8@%rax" or "4@-12(%rbp)".
+#define PARSER_PROBE_SIZE(x) \
+    ((std::is_signed<decltype(x)>::value ? -1 : 1) * static_cast<int>(sizeof(x)))
+
+#define PARSER_PROBE2(name, first, second) \
+    __asm__ __volatile__(PARSER_PROBE_NOTE(name, "%c[size1]@%[arg1] %c[size2]@%[arg2]") \
+                         : \
+                         : [size1] "n"(PARSER_PROBE_SIZE(first)), [arg1] "nor"(first), \
+                           [size2] "n"(PARSER_PROBE_SIZE(second)), [arg2] "nor"(second))
+#define PARSER_HAS_PROBES 1
+#endif
+#endif
+
+#endif
@@ -0,0 +1,27 @@
+#include "parser_core.hpp"
+#include <string>
+
+struct ParserWithAbort : IParser {
+    using IParser::execute;
+
+    int64_t execute(const char* program, size_t length) const final {
+        return execute_program<AbortPolicy>(program, length);
+    }
+
+    int64_t execute(const char* program, size_t length, ErrorKind* error) const final {
+        return execute_program<AbortPolicy>(program, length, error);
+    }
+
+    std::string execute_big(const char* program, size_t length) const final {
+        return execute_big_program<AbortPolicy>(program, length);
+    }
+
+    std::unique_ptr<IProgram> compile(const char* program, size_t length,
+                                      const std::vector<std::string>& names) const final {
+        return std::unique_ptr<IProgram>{new CompiledProgram<AbortPolicy>{program, length, names}};
+    }
+};
+
+std::unique_ptr<IParser> make_parser_with_abort() {
+    return std::unique_ptr<IParser>{new ParserWithAbort};
+}
@@ -0,0 +1,336 @@
+#include "parser_core.hpp"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#if defined(PARSER_COROUTINES)
+#include <coroutine>
+
+// The grammar with every recursive rule as a coroutine returning a Task<T>.
+// co_await on a Task runs the rule and yields its value, and co_await on a
+// Result<T> (what the shared lexical rules of Parser return) yields the value
+// or fails; either way a failure goes straight back to whoever started the
+// parse, like Rust's ? operator all the way up. The frames that are left
+// suspended are destroyed with the outermost Task.
+//
+// Awaiting a rule, or finishing one, suspends and leaves it to a loop in
+// Task::run to resume the next rule. Symmetric transfer (await_suspend
+// returning the next handle) would skip the loop, but it only runs in
+// constant stack space where the compiler turns it into a tail call; without
+// one, every rule that finishes adds native frames until the parse is over.
+
+// Coroutine frames, allocated and freed as a stack: a rule's frame is always
+// freed before the frame of the rule that awaited it. Chunks are kept for the
+// next parse, so in the steady state nothing is allocated from the heap.
+class FrameArena {
+public:
+    uint64_t frames = 0;
+
+    void* allocate(size_t size) {
+        size = (size + 15) & ~size_t{15};
+        ++frames;
+        if (size > static_cast<size_t>(limit - top)) {
+            next_chunk(size);
+        }
+        void* frame = top;
+        top += size;
+        return frame;
+    }
+
+    void deallocate(void* frame) {
+        char* p = static_cast<char*>(frame);
+        if (!contains(p)) {
+            enter(--current);
+        }
+        top = p;
+    }
+
+private:
+    struct Chunk {
+        std::unique_ptr<char[]> memory;
+        size_t size;
+    };
+
+    std::vector<Chunk> chunks;
+    size_t current = 0;
+    char* begin = nullptr;
+    char* top = nullptr;
+    char* limit = nullptr;
+
+    bool contains(const char* p) const {
+        uintptr_t address = reinterpret_cast<uintptr_t>(p);
+        return address >= reinterpret_cast<uintptr_t>(begin) && address < reinterpret_cast<uintptr_t>(limit);
+    }
+
+    void enter(size_t chunk) {
+        current = chunk;
+        begin = chunks[chunk].memory.get();
+        top = begin;
+        limit = begin + chunks[chunk].size;
+    }
+
+    void next_chunk(size_t size) {
+        const size_t chunk_bytes = 64 * 1024;
+        size_t next = begin ? current + 1 : 0;
+        if (next < chunks.size() && chunks[next].size < size) {
+            chunks.resize(next);
+        }
+        if (next == chunks.size()) {
+            size_t bytes = std::max(size, chunk_bytes);
+            chunks.push_back(Chunk{std::unique_ptr<char[]>(new char[bytes]), bytes});
+        }
+        enter(next);
+    }
+};
+
+thread_local FrameArena frame_arena;
+
+// One parse: the rule to resume next, and the error once it has failed.
+struct ParseState {
+    std::coroutine_handle<> next;
+    bool failed = false;
+    ErrorKind error = ErrorKind::UnexpectedEOF;
+
+    void fail(ErrorKind kind) {
+        failed = true;
+        error = kind;
+    }
+};
+
+// What a rule co_returns to fail.
+struct Failure {
+    ErrorKind kind;
+};
+
+inline Failure fail(ErrorKind kind) {
+    return Failure{kind};
+}
+
+template <class T>
+class Task;
+
+// Yields the value of a Result, or fails the parse.
+template <class T>
+struct ResultAwaiter {
+    Result<T> result;
+
+    bool await_ready() const noexcept { return !result.is_error; }
+
+    template <class Promise>
+    void await_suspend(std::coroutine_handle<Promise> rule) const noexcept {
+        rule.promise().state->fail(result.error);
+    }
+
+    T await_resume() const noexcept { return result.ok; }
+};
+
+template <class T>
+struct TaskPromise {
+    T value{};
+    std::coroutine_handle<> continuation;  // null for the outermost rule
+    ParseState* state = nullptr;
+
+    static void* operator new(size_t size) { return frame_arena.allocate(size); }
+    static void operator delete(void* frame) { frame_arena.deallocate(frame); }
+
+    Task<T> get_return_object();
+
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+
+    // Resumes the awaiting rule next, unless the parse has failed.
+    struct FinalAwaiter {
+        bool await_ready() const noexcept { return false; }
+
+        void await_suspend(std::coroutine_handle<TaskPromise> rule) const noexcept {
+            TaskPromise& promise = rule.promise();
+            if (!promise.state->failed) {
+                promise.state->next = promise.continuation;
+            }
+        }
+
+        void await_resume() const noexcept {}
+    };
+
+    FinalAwaiter final_suspend() const noexcept { return {}; }
+
+    void return_value(T result) { value = result; }
+    void return_value(Failure failure) { state->fail(failure.kind); }
+
+    void unhandled_exception() { throw; }
+
+    template <class U>
+    Task<U>&& await_transform(Task<U>&& task) const noexcept { return std::move(task); }
+
+    template <class U>
+    ResultAwaiter<U> await_transform(Result<U> result) const noexcept { return ResultAwaiter<U>{result}; }
+};
+
+template <class T>
+class Task {
+public:
+    using promise_type = TaskPromise<T>;
+
+    explicit Task(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+    Task(Task&& other) noexcept : handle(other.handle) { other.handle = nullptr; }
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    ~Task() {
+        if (handle) {
+            handle.destroy();
+        }
+    }
+
+    bool await_ready() const noexcept { return false; }
+
+    template <class U>
+    void await_suspend(std::coroutine_handle<TaskPromise<U>> awaiting) const noexcept {
+        handle.promise().continuation = awaiting;
+        handle.promise().state = awaiting.promise().state;
+        awaiting.promise().state->next = handle;
+    }
+
+    T await_resume() const noexcept { return handle.promise().value; }
+
+    // Runs the rule as the outermost one of a parse.
+    Result<T> run() {
+        ParseState state;
+        handle.promise().state = &state;
+        state.next = handle;
+        while (state.next) {
+            std::coroutine_handle<> rule = state.next;
+            state.next = nullptr;
+            rule.resume();
+        }
+        if (state.failed) {
+            return Result<T>{state.error};
+        } else {
+            return Result<T>{handle.promise().value};
+        }
+    }
+
+private:
+    std::coroutine_handle<promise_type> handle;
+};
+
+template <class T>
+Task<T> TaskPromise<T>::get_return_object() {
+    return Task<T>{std::coroutine_handle<TaskPromise>::from_promise(*this)};
+}
+
+template <class Arithmetic = CheckedArithmetic>
+struct CoroutineParser {
+    using Value = typename Arithmetic::Value;
+
+    // Numbers, variables and single characters, which don't recurse.
+    Parser<ResultPolicy, Arithmetic> lexer;
+
+    Task<Value> inner_expression() {
+        Op op = co_await operation();
+        Value left = co_await expression();
+        Value right = co_await expression();
+
+        Value n = Value{};
+        bool overflow = false;
+        switch (op) {
+            case Op::Add: overflow = lexer.arithmetic.add(left, right, n); break;
+            case Op::Sub: overflow = lexer.arithmetic.sub(left, right, n); break;
+            case Op::Mul: overflow = lexer.arithmetic.mul(left, right, n); break;
+            case Op::Div:
+                if (lexer.arithmetic.divide_by_zero(right)) {
+                    co_return fail(ErrorKind::DivideByZero);
+                }
+                overflow = lexer.arithmetic.div(left, right, n);
+                break;
+            default: co_return fail(ErrorKind::InvalidOperator);
+        }
+        if (overflow) {
+            co_return fail(ErrorKind::Overflow);
+        }
+        co_return n;
+    }
+
+    Task<Value> expression() {
+        lexer.skip_whitespace();
+        char c = lexer.peek();
+        if (c == '(') {
+            lexer.get_char();
+            lexer.skip_whitespace();
+            Value val = co_await expression();
+            lexer.skip_whitespace();
+            co_await lexer.expect_char(')');
+            co_return val;
+        } else if (c >= '0' && c <= '9') {
+            co_return co_await lexer.number();
+        } else if (Arithmetic::has_variables && (char_classes[static_cast<unsigned char>(c)] & CharLetter)) {
+            co_return co_await lexer.variable();
+        } else {
+            co_return co_await inner_expression();
+        }
+    }
+
+    Task<Op> operation() {
+        char c = co_await lexer.get_char();
+        switch (c) {
+            case '+': co_return Op::Add;
+            case '-': co_return Op::Sub;
+            case '*': co_return Op::Mul;
+            case '/': co_return Op::Div;
+            default:  co_return fail(ErrorKind::InvalidOperator);
+        }
+    }
+};
+
+template <class Arithmetic = CheckedArithmetic>
+Result<typename Arithmetic::Value> evaluate_with_coroutines(const char* begin, const char* end,
+                                                            Arithmetic arithmetic = Arithmetic{}) {
+    CoroutineParser<Arithmetic> parser{{begin, end, arithmetic}};
+    return parser.expression().run();
+}
+
+struct ParserWithCoroutines : IParser {
+    using IParser::execute;
+
+    int64_t execute(const char* program, size_t length) const final {
+        return execute(program, length, nullptr);
+    }
+
+    int64_t execute(const char* program, size_t length, ErrorKind* error) const final {
+        Result<int64_t> result = evaluate_with_coroutines(program, program + length);
+        if (result.is_error) {
+            if (error) {
+                *error = result.error;
+            }
+            return 0;
+        } else {
+            return result.ok;
+        }
+    }
+
+    std::string execute_big(const char* program, size_t length) const final {
+        BigArena arena;
+        Result<BigValue> result = evaluate_with_coroutines(program, program + length, BigArithmetic{&arena});
+        if (result.is_error) {
+            return std::string{};
+        } else {
+            return to_decimal(result.ok);
+        }
+    }
+
+    // Compiled programs are bytecode, which doesn't go through the grammar
+    // again; they are run like the results engine's.
+    std::unique_ptr<IProgram> compile(const char* program, size_t length,
+                                      const std::vector<std::string>& names) const final {
+        return std::unique_ptr<IProgram>{new CompiledProgram<ResultPolicy>{program, length, names}};
+    }
+};
+
+std::unique_ptr<IParser> make_parser_with_coroutines() {
+    return std::unique_ptr<IParser>{new ParserWithCoroutines};
+}
+
+uint64_t coroutine_frames_allocated() {
+    return frame_arena.frames;
+}
+#endif
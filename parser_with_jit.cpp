@@ -0,0 +1,253 @@
+#include "parser_core.hpp"
+#include <cstring>
+#include <initializer_list>
+#include <vector>
+
+#if defined(__x86_64__) && (defined(__linux__) || defined(__FreeBSD__)) && !defined(PARSER_NO_JIT)
+#define PARSER_JIT 1
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// The bytecode of a program (see Bytecode in parser_core.hpp) is interpreted
+// until the program has been called often enough to be worth translating into
+// x86-64 code.
+
+#if defined(PARSER_JIT)
+// What the native code returns, in rax and rdx: the value, and 0 or one more
+// than the ErrorKind.
+struct NativeResult {
+    int64_t value;
+    int64_t error;
+};
+
+using NativeFunction = NativeResult (*)(const int64_t* bindings);
+
+// Translates the bytecode into x86-64 code for the System V ABI. The top of
+// the stack is kept in rax and the rest on the machine stack; rbx holds the
+// stack pointer on entry, so that the error exits can drop whatever is left.
+// The bindings arrive in rdi.
+struct X86Assembler {
+    std::vector<uint8_t> bytes;
+    std::vector<size_t> overflow_jumps;
+    std::vector<size_t> divide_by_zero_jumps;
+
+    void emit(std::initializer_list<uint8_t> code) {
+        bytes.insert(bytes.end(), code);
+    }
+
+    void emit_bytes(const void* data, size_t size) {
+        const uint8_t* p = static_cast<const uint8_t*>(data);
+        bytes.insert(bytes.end(), p, p + size);
+    }
+
+    // A jump with a 32-bit displacement to be filled in by bind.
+    void jump(std::initializer_list<uint8_t> opcode, std::vector<size_t>& jumps) {
+        emit(opcode);
+        jumps.push_back(bytes.size());
+        emit({0, 0, 0, 0});
+    }
+
+    void bind(const std::vector<size_t>& jumps) {
+        for (size_t at : jumps) {
+            int32_t displacement = static_cast<int32_t>(bytes.size() - (at + 4));
+            std::memcpy(&bytes[at], &displacement, 4);
+        }
+    }
+
+    void error_exit(ErrorKind kind) {
+        int32_t error = static_cast<int32_t>(kind) + 1;
+        emit({0x31, 0xC0});                  // xor eax, eax
+        emit({0xBA});                        // mov edx, error
+        emit_bytes(&error, 4);
+        emit({0x48, 0x89, 0xDC});            // mov rsp, rbx
+        emit({0x5B});                        // pop rbx
+        emit({0xC3});                        // ret
+    }
+
+    void compile(const std::vector<Instruction>& code) {
+        emit({0x53});                        // push rbx
+        emit({0x48, 0x89, 0xE3});            // mov rbx, rsp
+
+        size_t depth = 0;
+        for (const Instruction& instruction : code) {
+            switch (instruction.opcode) {
+                case Opcode::Push: {
+                    if (depth++ > 0) {
+                        emit({0x50});        // push rax
+                    }
+                    int64_t constant = instruction.operand;
+                    if (constant >= INT32_MIN && constant <= INT32_MAX) {
+                        int32_t imm32 = static_cast<int32_t>(constant);
+                        emit({0x48, 0xC7, 0xC0});  // mov rax, imm32
+                        emit_bytes(&imm32, 4);
+                    } else {
+                        emit({0x48, 0xB8});  // mov rax, imm64
+                        emit_bytes(&constant, 8);
+                    }
+                    break;
+                }
+                case Opcode::Load: {
+                    if (depth++ > 0) {
+                        emit({0x50});        // push rax
+                    }
+                    int32_t offset = static_cast<int32_t>(instruction.operand * 8);
+                    emit({0x48, 0x8B, 0x87});  // mov rax, [rdi + offset]
+                    emit_bytes(&offset, 4);
+                    break;
+                }
+                case Opcode::Add:
+                    emit({0x59});                        // pop rcx
+                    emit({0x48, 0x01, 0xC8});            // add rax, rcx
+                    jump({0x0F, 0x80}, overflow_jumps);  // jo overflow
+                    break;
+                case Opcode::Sub:
+                    emit({0x59});                        // pop rcx
+                    emit({0x48, 0x29, 0xC1});            // sub rcx, rax
+                    jump({0x0F, 0x80}, overflow_jumps);  // jo overflow
+                    emit({0x48, 0x89, 0xC8});            // mov rax, rcx
+                    break;
+                case Opcode::Mul:
+                    emit({0x59});                        // pop rcx
+                    emit({0x48, 0x0F, 0xAF, 0xC1});      // imul rax, rcx
+                    jump({0x0F, 0x80}, overflow_jumps);  // jo overflow
+                    break;
+                case Opcode::Div:
+                    emit({0x48, 0x89, 0xC1});            // mov rcx, rax
+                    emit({0x58});                        // pop rax
+                    emit({0x48, 0x85, 0xC9});            // test rcx, rcx
+                    jump({0x0F, 0x84}, divide_by_zero_jumps);  // jz divide_by_zero
+                    // Dividing by -1 is negation, which is where INT64_MIN
+                    // overflows; idiv would trap instead.
+                    emit({0x48, 0x83, 0xF9, 0xFF});      // cmp rcx, -1
+                    emit({0x75, 0x0B});                  // jne .idiv
+                    emit({0x48, 0xF7, 0xD8});            // neg rax
+                    jump({0x0F, 0x80}, overflow_jumps);  // jo overflow
+                    emit({0xEB, 0x05});                  // jmp .done
+                    emit({0x48, 0x99});                  // .idiv: cqo
+                    emit({0x48, 0xF7, 0xF9});            // idiv rcx
+                    break;                               // .done:
+                default:
+                    break;
+            }
+            if (instruction.opcode != Opcode::Push && instruction.opcode != Opcode::Load) {
+                --depth;
+            }
+        }
+
+        emit({0x31, 0xD2});                  // xor edx, edx
+        emit({0x5B});                        // pop rbx
+        emit({0xC3});                        // ret
+
+        bind(overflow_jumps);
+        error_exit(ErrorKind::Overflow);
+        bind(divide_by_zero_jumps);
+        error_exit(ErrorKind::DivideByZero);
+    }
+};
+#endif
+
+struct ProgramWithJit : IProgram {
+    using IProgram::execute;
+
+    Bytecode bytecode;
+    std::vector<int64_t> stack;
+    unsigned calls_until_jit;
+#if defined(PARSER_JIT)
+    NativeFunction native = nullptr;
+    size_t native_size = 0;
+    bool jit_failed = false;
+#endif
+
+    ProgramWithJit(const char* program, size_t length, const std::vector<std::string>& names, unsigned jit_threshold)
+        : bytecode(program, length, names), stack(bytecode.stack_depth), calls_until_jit(jit_threshold) {}
+
+    ~ProgramWithJit() {
+#if defined(PARSER_JIT)
+        if (native) {
+            ::munmap(reinterpret_cast<void*>(native), native_size);
+        }
+#endif
+    }
+
+    int64_t execute(const int64_t* bindings, ErrorKind* error) final {
+        Result<int64_t> result = run(bindings);
+        if (result.is_error) {
+            if (error) {
+                *error = result.error;
+            }
+            return 0;
+        } else {
+            return result.ok;
+        }
+    }
+
+    void execute_columns(const int64_t* const* columns, size_t rows, int64_t* results, uint64_t* errors) final {
+        execute_bytecode_columns(bytecode, best_column_isa(), columns, rows, results, errors);
+    }
+
+    size_t memory_bytes() const final {
+        size_t bytes = bytecode.memory_bytes() + stack.capacity() * sizeof(int64_t);
+#if defined(PARSER_JIT)
+        bytes += native_size;
+#endif
+        return bytes;
+    }
+
+    Result<int64_t> run(const int64_t* bindings) {
+        if (bytecode.code.empty()) {
+            return Result<int64_t>{bytecode.error};
+        }
+#if defined(PARSER_JIT)
+        if (native) {
+            NativeResult result = native(bindings);
+            if (result.error) {
+                return Result<int64_t>{static_cast<ErrorKind>(result.error - 1)};
+            }
+            return Result<int64_t>{result.value};
+        }
+        if (calls_until_jit == 0 && !jit_failed) {
+            compile();
+            return run(bindings);
+        }
+#endif
+        if (calls_until_jit > 0) {
+            --calls_until_jit;
+        }
+        return run_bytecode<ResultPolicy>(bytecode.code, stack.data(), bindings);
+    }
+
+#if defined(PARSER_JIT)
+    // Maps the code writable, then executable, never both at once. If that
+    // fails, the program stays interpreted.
+    void compile() {
+        X86Assembler assembler;
+        assembler.compile(bytecode.code);
+
+        size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+        size_t size = (assembler.bytes.size() + page - 1) / page * page;
+        void* memory = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED) {
+            jit_failed = true;
+            return;
+        }
+        std::memcpy(memory, assembler.bytes.data(), assembler.bytes.size());
+        if (::mprotect(memory, size, PROT_READ | PROT_EXEC) != 0) {
+            ::munmap(memory, size);
+            jit_failed = true;
+            return;
+        }
+        native = reinterpret_cast<NativeFunction>(memory);
+        native_size = size;
+    }
+#endif
+};
+
+std::unique_ptr<IProgram> make_program_with_jit(const char* program, size_t length,
+                                                const std::vector<std::string>& names, unsigned jit_threshold) {
+    return std::unique_ptr<IProgram>{new ProgramWithJit{program, length, names, jit_threshold}};
+}
+
+std::unique_ptr<IProgram> make_program_with_jit(const char* program, size_t length, unsigned jit_threshold) {
+    return make_program_with_jit(program, length, std::vector<std::string>{}, jit_threshold);
+}
@@ -0,0 +1,29 @@
+#include "parser_core.hpp"
+#include <string>
+
+// The lower bound: the grammar without any error handling, and with
+// arithmetic that wraps around (see UncheckedPolicy and UncheckedArithmetic).
+struct ParserWithNoChecks : IParser {
+    using IParser::execute;
+
+    int64_t execute(const char* program, size_t length) const final {
+        return execute_program<UncheckedPolicy, UncheckedArithmetic>(program, length);
+    }
+
+    int64_t execute(const char* program, size_t length, ErrorKind* error) const final {
+        return execute_program<UncheckedPolicy, UncheckedArithmetic>(program, length, error);
+    }
+
+    std::string execute_big(const char* program, size_t length) const final {
+        return execute_big_program<UncheckedPolicy>(program, length);
+    }
+
+    std::unique_ptr<IProgram> compile(const char* program, size_t length,
+                                      const std::vector<std::string>& names) const final {
+        return std::unique_ptr<IProgram>{new CompiledProgram<UncheckedPolicy>{program, length, names}};
+    }
+};
+
+std::unique_ptr<IParser> make_parser_with_no_checks() {
+    return std::unique_ptr<IParser>{new ParserWithNoChecks};
+}
@@ -0,0 +1,228 @@
+#include "parser_core.hpp"
+#include <vector>
+
+#if (defined(__x86_64__) || defined(__i386__)) && !defined(PARSER_NO_SIMD)
+#define PARSER_X86_COLUMNS 1
+#include <immintrin.h>
+#endif
+
+// Columnar evaluation of bytecode (see execute_bytecode_columns in
+// parser_core.hpp). Rows are evaluated in blocks, with one buffer per stack
+// slot; every opcode runs over the whole block before the next one starts.
+// Errors are recorded per row in a bitmap, and the rows carry on with some
+// value, which is discarded at the end.
+
+const size_t column_block_rows = 256;
+
+struct ColumnBlock {
+    std::vector<int64_t> buffers;  // stack_depth buffers of column_block_rows values
+    std::vector<const int64_t*> stack;
+    uint64_t errors[column_block_rows / 64];
+};
+
+// The kernels work in place (r may be a), so results go through a local.
+
+inline void set_error(uint64_t* errors, size_t i) {
+    errors[i / 64] |= uint64_t{1} << (i % 64);
+}
+
+// Rows [first, n) of the block.
+void add_rows(size_t first, const int64_t* a, const int64_t* b, int64_t* r, size_t n, uint64_t* errors) {
+    for (size_t i = first; i < n; ++i) {
+        int64_t value;
+        if (__builtin_add_overflow(a[i], b[i], &value)) {
+            set_error(errors, i);
+        }
+        r[i] = value;
+    }
+}
+
+void add_scalar(const int64_t* a, const int64_t* b, int64_t* r, size_t n, uint64_t* errors) {
+    add_rows(0, a, b, r, n, errors);
+}
+
+void sub_rows(size_t first, const int64_t* a, const int64_t* b, int64_t* r, size_t n, uint64_t* errors) {
+    for (size_t i = first; i < n; ++i) {
+        int64_t value;
+        if (__builtin_sub_overflow(a[i], b[i], &value)) {
+            set_error(errors, i);
+        }
+        r[i] = value;
+    }
+}
+
+void sub_scalar(const int64_t* a, const int64_t* b, int64_t* r, size_t n, uint64_t* errors) {
+    sub_rows(0, a, b, r, n, errors);
+}
+
+// No 64-bit SIMD multiplication reports overflow, so this is lane by lane on
+// every ISA.
+void mul_scalar(const int64_t* a, const int64_t* b, int64_t* r, size_t n, uint64_t* errors) {
+    for (size_t i = 0; i < n; ++i) {
+        int64_t value;
+        if (__builtin_mul_overflow(a[i], b[i], &value)) {
+            set_error(errors, i);
+        }
+        r[i] = value;
+    }
+}
+
+// Neither has SIMD integer division.
+void div_scalar(const int64_t* a, const int64_t* b, int64_t* r, size_t n, uint64_t* errors) {
+    for (size_t i = 0; i < n; ++i) {
+        if (b[i] == 0 || (a[i] == INT64_MIN && b[i] == -1)) {
+            r[i] = 0;
+            set_error(errors, i);
+        } else {
+            r[i] = a[i] / b[i];
+        }
+    }
+}
+
+#if defined(PARSER_X86_COLUMNS)
+// Overflow is in the sign bit of (a ^ r) & (b ^ r) for a + b, and of
+// (a ^ b) & (a ^ r) for a - b.
+__attribute__((target("avx2")))
+void add_avx2(const int64_t* a, const int64_t* b, int64_t* r, size_t n, uint64_t* errors) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        __m256i z = _mm256_add_epi64(x, y);
+        __m256i overflow = _mm256_and_si256(_mm256_xor_si256(x, z), _mm256_xor_si256(y, z));
+        errors[i / 64] |= uint64_t(_mm256_movemask_pd(_mm256_castsi256_pd(overflow))) << (i % 64);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(r + i), z);
+    }
+    add_rows(i, a, b, r, n, errors);
+}
+
+__attribute__((target("avx2")))
+void sub_avx2(const int64_t* a, const int64_t* b, int64_t* r, size_t n, uint64_t* errors) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        __m256i z = _mm256_sub_epi64(x, y);
+        __m256i overflow = _mm256_and_si256(_mm256_xor_si256(x, y), _mm256_xor_si256(x, z));
+        errors[i / 64] |= uint64_t(_mm256_movemask_pd(_mm256_castsi256_pd(overflow))) << (i % 64);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(r + i), z);
+    }
+    sub_rows(i, a, b, r, n, errors);
+}
+
+__attribute__((target("avx512f")))
+void add_avx512(const int64_t* a, const int64_t* b, int64_t* r, size_t n, uint64_t* errors) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m512i x = _mm512_loadu_si512(a + i);
+        __m512i y = _mm512_loadu_si512(b + i);
+        __m512i z = _mm512_add_epi64(x, y);
+        __m512i overflow = _mm512_and_si512(_mm512_xor_si512(x, z), _mm512_xor_si512(y, z));
+        errors[i / 64] |= uint64_t(_mm512_cmplt_epi64_mask(overflow, _mm512_setzero_si512())) << (i % 64);
+        _mm512_storeu_si512(r + i, z);
+    }
+    add_rows(i, a, b, r, n, errors);
+}
+
+__attribute__((target("avx512f")))
+void sub_avx512(const int64_t* a, const int64_t* b, int64_t* r, size_t n, uint64_t* errors) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m512i x = _mm512_loadu_si512(a + i);
+        __m512i y = _mm512_loadu_si512(b + i);
+        __m512i z = _mm512_sub_epi64(x, y);
+        __m512i overflow = _mm512_and_si512(_mm512_xor_si512(x, y), _mm512_xor_si512(x, z));
+        errors[i / 64] |= uint64_t(_mm512_cmplt_epi64_mask(overflow, _mm512_setzero_si512())) << (i % 64);
+        _mm512_storeu_si512(r + i, z);
+    }
+    sub_rows(i, a, b, r, n, errors);
+}
+#endif
+
+bool column_isa_supported(ColumnIsa isa) {
+    switch (isa) {
+        case ColumnIsa::Scalar: return true;
+#if defined(PARSER_X86_COLUMNS)
+        case ColumnIsa::Avx2: return __builtin_cpu_supports("avx2");
+        case ColumnIsa::Avx512: return __builtin_cpu_supports("avx512f");
+#endif
+        default: return false;
+    }
+}
+
+ColumnIsa best_column_isa() {
+    static const ColumnIsa best = column_isa_supported(ColumnIsa::Avx512) ? ColumnIsa::Avx512
+                                : column_isa_supported(ColumnIsa::Avx2) ? ColumnIsa::Avx2
+                                : ColumnIsa::Scalar;
+    return best;
+}
+
+void execute_bytecode_columns(const Bytecode& bytecode, ColumnIsa isa, const int64_t* const* columns, size_t rows,
+                              int64_t* results, uint64_t* errors) {
+    using Kernel = void (*)(const int64_t*, const int64_t*, int64_t*, size_t, uint64_t*);
+    Kernel add = add_scalar;
+    Kernel sub = sub_scalar;
+#if defined(PARSER_X86_COLUMNS)
+    if (isa == ColumnIsa::Avx512) {
+        add = add_avx512;
+        sub = sub_avx512;
+    } else if (isa == ColumnIsa::Avx2) {
+        add = add_avx2;
+        sub = sub_avx2;
+    }
+#endif
+
+    for (size_t w = 0; w < (rows + 63) / 64; ++w) {
+        errors[w] = 0;
+    }
+    if (bytecode.code.empty()) {
+        for (size_t row = 0; row < rows; ++row) {
+            results[row] = 0;
+            set_error(errors, row);
+        }
+        return;
+    }
+
+    ColumnBlock block;
+    block.buffers.resize(bytecode.stack_depth * column_block_rows);
+    block.stack.resize(bytecode.stack_depth);
+    for (size_t start = 0; start < rows; start += column_block_rows) {
+        size_t n = std::min(column_block_rows, rows - start);
+        std::fill(block.errors, block.errors + column_block_rows / 64, uint64_t{0});
+
+        size_t top = 0;
+        for (const Instruction& instruction : bytecode.code) {
+            if (instruction.opcode == Opcode::Push) {
+                int64_t* buffer = &block.buffers[top * column_block_rows];
+                std::fill(buffer, buffer + n, instruction.operand);
+                block.stack[top++] = buffer;
+                continue;
+            }
+            if (instruction.opcode == Opcode::Load) {
+                block.stack[top++] = columns[instruction.operand] + start;
+                continue;
+            }
+
+            const int64_t* left = block.stack[top - 2];
+            const int64_t* right = block.stack[top - 1];
+            int64_t* buffer = &block.buffers[(top - 2) * column_block_rows];
+            switch (instruction.opcode) {
+                case Opcode::Add: add(left, right, buffer, n, block.errors); break;
+                case Opcode::Sub: sub(left, right, buffer, n, block.errors); break;
+                case Opcode::Mul: mul_scalar(left, right, buffer, n, block.errors); break;
+                case Opcode::Div: div_scalar(left, right, buffer, n, block.errors); break;
+                default: break;
+            }
+            block.stack[top - 2] = buffer;
+            --top;
+        }
+
+        for (size_t i = 0; i < n; ++i) {
+            bool error = (block.errors[i / 64] >> (i % 64)) & 1;
+            results[start + i] = error ? 0 : block.stack[0][i];
+        }
+        for (size_t w = 0; w < (n + 63) / 64; ++w) {
+            errors[start / 64 + w] = block.errors[w];
+        }
+    }
+}
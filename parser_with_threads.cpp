@@ -0,0 +1,280 @@
+#include "parser_core.hpp"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// Evaluation of one very large program on several threads (see
+// execute_in_parallel in parser.hpp), in three passes:
+//
+// 1. The depth of parentheses is summed up per block of the program, on
+//    every thread, which is enough to find the ')' that closes any '('
+//    without scanning everything in between (ParenIndex).
+// 2. The outer operators are walked on the calling thread, like the engines
+//    parse them, down to parenthesized operands that are small enough to be
+//    handed to a thread. The walk comes out as postfix bytecode, in which
+//    every operand handed over is a Load (Skeleton).
+// 3. The operands are evaluated on the threads, and then the bytecode with
+//    their values as the bindings.
+//
+// An operand in parentheses parses the same on its own as in the middle of
+// the program: the parser never looks past the ')' that closes it. So the
+// first error in the bytecode, whether one of its own or in an operand it
+// loads, is the first error the engines would find.
+
+const size_t paren_block_size = 64 * 1024;
+
+// Programs, and operands, smaller than this aren't worth a thread.
+const size_t min_parallel_bytes = 1 << 20;
+
+// From this many levels of outer operators down, operands are handed to
+// threads whatever their size.
+const unsigned max_skeleton_depth = 64;
+
+// The parentheses in a block: the depth at its start, how the depth changes
+// over the block, and the lowest depth reached in it, after any character,
+// relative to its start.
+struct ParenBlock {
+    int64_t start_depth;
+    int32_t delta;
+    int32_t min_depth;
+};
+
+// Runs f(0) to f(count - 1) on up to threads threads, including the calling
+// one.
+template <class F>
+void parallel_for(size_t count, unsigned threads, F f) {
+    std::atomic<size_t> next{0};
+    auto work = [&]() {
+        for (size_t i = next++; i < count; i = next++) {
+            f(i);
+        }
+    };
+    std::vector<std::thread> helpers;
+    for (unsigned t = 1; t < threads && t < count; ++t) {
+        helpers.emplace_back(work);
+    }
+    work();
+    for (std::thread& helper : helpers) {
+        helper.join();
+    }
+}
+
+ParenBlock summarize_parens(const char* p, size_t length) {
+    int32_t depth = 0;
+    int32_t min_depth = 0;
+    char padded[64];
+    for (size_t i = 0; i < length; i += 64) {
+        const char* group = p + i;
+        if (length - i < 64) {
+            std::memset(padded, 0, sizeof(padded));
+            std::memcpy(padded, group, length - i);
+            group = padded;
+        }
+        uint64_t opens;
+        uint64_t closes;
+        find_parens_64(group, opens, closes);
+        // The depth only goes down at a ')', so that's where the lowest one is,
+        // and only a group with enough of them can go below the lowest yet.
+        int32_t close_count = __builtin_popcountll(closes);
+        for (uint64_t rest = depth - close_count < min_depth ? closes : 0; rest; rest &= rest - 1) {
+            uint64_t upto = ~uint64_t{0} >> (63 - __builtin_ctzll(rest));
+            int32_t d = depth + __builtin_popcountll(opens & upto) - __builtin_popcountll(closes & upto);
+            min_depth = std::min(min_depth, d);
+        }
+        depth += __builtin_popcountll(opens) - close_count;
+    }
+    return ParenBlock{0, depth, min_depth};
+}
+
+class ParenIndex {
+public:
+    ParenIndex(const char* begin, const char* end, unsigned threads)
+        : begin(begin), end(end), blocks((static_cast<size_t>(end - begin) + paren_block_size - 1) / paren_block_size) {
+        parallel_for(blocks.size(), threads, [&](size_t b) {
+            const char* block = begin + b * paren_block_size;
+            blocks[b] = summarize_parens(block, std::min<size_t>(paren_block_size, static_cast<size_t>(end - block)));
+        });
+        int64_t depth = 0;
+        for (ParenBlock& block : blocks) {
+            block.start_depth = depth;
+            depth += block.delta;
+        }
+    }
+
+    // The ')' that closes the '(' at open, or end if there is none.
+    const char* find_close(const char* open) const {
+        size_t b = static_cast<size_t>(open - begin) / paren_block_size;
+        const char* block = begin + b * paren_block_size;
+        int64_t depth = blocks[b].start_depth + depth_change(block, open);
+        const char* found = scan(open, block_end(b), depth, depth);
+        if (found != block_end(b)) {
+            return found;
+        }
+        for (++b; b < blocks.size(); ++b) {
+            if (blocks[b].start_depth + blocks[b].min_depth <= depth) {
+                return scan(begin + b * paren_block_size, block_end(b), blocks[b].start_depth, depth);
+            }
+        }
+        return end;
+    }
+
+private:
+    const char* begin;
+    const char* end;
+    std::vector<ParenBlock> blocks;
+
+    const char* block_end(size_t b) const {
+        return begin + std::min<size_t>((b + 1) * paren_block_size, static_cast<size_t>(end - begin));
+    }
+
+    static int64_t depth_change(const char* p, const char* end) {
+        int64_t depth = 0;
+        for (; p != end; ++p) {
+            depth += (*p == '(') - (*p == ')');
+        }
+        return depth;
+    }
+
+    // The first ')' in [p, end) after which the depth, starting at depth, is
+    // target, or end.
+    static const char* scan(const char* p, const char* end, int64_t depth, int64_t target) {
+        for (; p != end; ++p) {
+            depth += (*p == '(') - (*p == ')');
+            if (*p == ')' && depth == target) {
+                return p;
+            }
+        }
+        return end;
+    }
+};
+
+struct Operand {
+    const char* begin;
+    const char* end;
+};
+
+// Walks the outer operators of a program like Parser::expression, emitting
+// bytecode for them, and a Load for every operand in parentheses that is
+// smaller than split_bytes. Stops at the first error of its own.
+class Skeleton {
+public:
+    std::vector<Instruction> code;
+    std::vector<Operand> operands;
+    bool failed = false;
+    ErrorKind error = ErrorKind::UnexpectedEOF;
+
+    Skeleton(const char* begin, const char* end, const ParenIndex& parens, size_t split_bytes)
+        : lexer(begin, end), parens(parens), split_bytes(split_bytes) {}
+
+    bool expression(unsigned depth) {
+        lexer.skip_whitespace();
+        char c = lexer.peek();
+        if (c == '(') {
+            const char* close = parens.find_close(lexer.p);
+            if (close != lexer.end && (static_cast<size_t>(close - lexer.p) < split_bytes || depth >= max_skeleton_depth)) {
+                code.push_back(Instruction{Opcode::Load, static_cast<int64_t>(operands.size())});
+                operands.push_back(Operand{lexer.p, close + 1});
+                lexer.p = close + 1;
+                return true;
+            }
+            lexer.get_char();
+            lexer.skip_whitespace();
+            if (!expression(depth + 1)) {
+                return false;
+            }
+            lexer.skip_whitespace();
+            return check(lexer.expect_char(')'));
+        } else if (c >= '0' && c <= '9') {
+            Result<int64_t> n = lexer.number();
+            if (!check(n)) {
+                return false;
+            }
+            code.push_back(Instruction{Opcode::Push, n.ok});
+            return true;
+        } else {
+            Result<Op> op = lexer.operation();
+            if (!check(op) || !expression(depth + 1) || !expression(depth + 1)) {
+                return false;
+            }
+            switch (op.ok) {
+                case Op::Add: code.push_back(Instruction{Opcode::Add, 0}); break;
+                case Op::Sub: code.push_back(Instruction{Opcode::Sub, 0}); break;
+                case Op::Mul: code.push_back(Instruction{Opcode::Mul, 0}); break;
+                case Op::Div: code.push_back(Instruction{Opcode::Div, 0}); break;
+            }
+            return true;
+        }
+    }
+
+private:
+    Parser<ResultPolicy> lexer;
+    const ParenIndex& parens;
+    size_t split_bytes;
+
+    template <class T>
+    bool check(const Result<T>& r) {
+        if (r.is_error) {
+            failed = true;
+            error = r.error;
+        }
+        return !r.is_error;
+    }
+};
+
+Result<int64_t> evaluate_in_parallel(const char* begin, const char* end, unsigned threads) {
+    size_t length = static_cast<size_t>(end - begin);
+    if (threads <= 1 || length < 2 * min_parallel_bytes) {
+        return evaluate<ResultPolicy>(begin, end);
+    }
+
+    ParenIndex parens{begin, end, threads};
+    Skeleton skeleton{begin, end, parens, std::max(min_parallel_bytes, length / (threads * 8))};
+    skeleton.expression(0);
+
+    std::vector<Result<int64_t>> results(skeleton.operands.size(), Result<int64_t>{int64_t{0}});
+    parallel_for(results.size(), threads, [&](size_t i) {
+        results[i] = evaluate<ResultPolicy>(skeleton.operands[i].begin, skeleton.operands[i].end);
+    });
+
+    // Up to the first operand with an error, if any comes before the
+    // skeleton's own.
+    std::vector<Instruction>& code = skeleton.code;
+    std::vector<int64_t> values(results.size());
+    bool failed = skeleton.failed;
+    ErrorKind error = skeleton.error;
+    for (size_t i = 0; i < code.size(); ++i) {
+        if (code[i].opcode != Opcode::Load) {
+            continue;
+        }
+        const Result<int64_t>& result = results[static_cast<size_t>(code[i].operand)];
+        if (result.is_error) {
+            code.resize(i);
+            failed = true;
+            error = result.error;
+            break;
+        }
+        values[static_cast<size_t>(code[i].operand)] = result.ok;
+    }
+
+    std::vector<int64_t> stack(code.size() + 1);
+    Result<int64_t> result = run_bytecode<ResultPolicy>(code, stack.data(), values.data());
+    if (!result.is_error && failed) {
+        return Result<int64_t>{error};
+    }
+    return result;
+}
+
+int64_t execute_in_parallel(const char* program, size_t length, ErrorKind* error, unsigned threads) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    Result<int64_t> result = evaluate_in_parallel(program, program + length, threads);
+    if (result.is_error) {
+        if (error) {
+            *error = result.error;
+        }
+        return 0;
+    }
+    return result.ok;
+}
@@ -0,0 +1,233 @@
+#include "parser_core.hpp"
+#include <string>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(PARSER_SSE2)
+#define PARSER_X86_VALIDATION 1
+#include <immintrin.h>
+#endif
+
+// The exceptions engine behind a structural check (see
+// make_parser_with_validation in parser.hpp). The check reads the program
+// 64 bytes at a time, as three masks: bytes outside the grammar, '(' and ')'.
+// With AVX-512 one instruction covers the 64 bytes, with AVX2 two, and with
+// SSE2 four.
+//
+// A program that fails the check has an error, unless the parse ends before
+// the first bad byte, but which error depends on everything before it: an
+// Overflow or a DivideByZero comes first if there is one. So it is parsed
+// with the results engine, which finds the same error without throwing.
+
+// Without variables, letters and '_' are not in the grammar either.
+const unsigned char grammar_chars = CharSpace | CharDigit | CharOperator | CharOpenParen | CharCloseParen;
+
+// Whether the depth of parentheses, starting at depth, stays at 0 or above
+// over a group of 64 bytes. Moves depth to the end of the group.
+inline bool balance_group(uint64_t opens, uint64_t closes, int64_t& depth) {
+    int64_t close_count = __builtin_popcountll(closes);
+    if (close_count > depth) {
+        // The depth only goes down at a ')'.
+        for (uint64_t rest = closes; rest; rest &= rest - 1) {
+            uint64_t upto = ~uint64_t{0} >> (63 - __builtin_ctzll(rest));
+            if (depth + __builtin_popcountll(opens & upto) - __builtin_popcountll(closes & upto) < 0) {
+                return false;
+            }
+        }
+    }
+    depth += __builtin_popcountll(opens) - close_count;
+    return true;
+}
+
+// The same check for the bytes left over, one at a time.
+bool validate_bytes(const char* p, const char* end, int64_t depth) {
+    for (; p != end; ++p) {
+        if (!(char_classes[static_cast<unsigned char>(*p)] & grammar_chars)) {
+            return false;
+        }
+        depth += (*p == '(') - (*p == ')');
+        if (depth < 0) {
+            return false;
+        }
+    }
+    return depth == 0;
+}
+
+bool validate_scalar(const char* program, size_t length) {
+    return validate_bytes(program, program + length, 0);
+}
+
+#if defined(PARSER_X86_VALIDATION)
+// The grammar's bytes are '\t'..'\r', ' ', and '('..'9' but for ',' and '.'.
+// Adding 0x77 moves '\t'..'\r' to -128..-124, and adding 0x58 moves
+// '('..'9' to -128..-111, the lowest signed bytes.
+bool validate_sse2(const char* program, size_t length) {
+    const char* p = program;
+    const char* end = program + length;
+    int64_t depth = 0;
+    for (; end - p >= 64; p += 64) {
+        uint64_t bad = 0;
+        uint64_t opens = 0;
+        uint64_t closes = 0;
+        for (unsigned i = 0; i < 64; i += 16) {
+            __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+            __m128i space = _mm_cmpeq_epi8(bytes, _mm_set1_epi8(' '));
+            __m128i control = _mm_cmplt_epi8(_mm_add_epi8(bytes, _mm_set1_epi8(0x77)), _mm_set1_epi8(-123));
+            __m128i range = _mm_cmplt_epi8(_mm_add_epi8(bytes, _mm_set1_epi8(0x58)), _mm_set1_epi8(-110));
+            __m128i gaps = _mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(',')), _mm_cmpeq_epi8(bytes, _mm_set1_epi8('.')));
+            __m128i ok = _mm_or_si128(_mm_or_si128(space, control), _mm_andnot_si128(gaps, range));
+            bad |= uint64_t{static_cast<uint16_t>(~_mm_movemask_epi8(ok))} << i;
+            opens |= uint64_t{static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('('))))} << i;
+            closes |= uint64_t{static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(')'))))} << i;
+        }
+        if (bad || !balance_group(opens, closes, depth)) {
+            return false;
+        }
+    }
+    return validate_bytes(p, end, depth);
+}
+
+__attribute__((target("avx2")))
+bool validate_avx2(const char* program, size_t length) {
+    const char* p = program;
+    const char* end = program + length;
+    int64_t depth = 0;
+    for (; end - p >= 64; p += 64) {
+        uint64_t bad = 0;
+        uint64_t opens = 0;
+        uint64_t closes = 0;
+        for (unsigned i = 0; i < 64; i += 32) {
+            __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+            __m256i space = _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(' '));
+            __m256i control = _mm256_cmpgt_epi8(_mm256_set1_epi8(-123), _mm256_add_epi8(bytes, _mm256_set1_epi8(0x77)));
+            __m256i range = _mm256_cmpgt_epi8(_mm256_set1_epi8(-110), _mm256_add_epi8(bytes, _mm256_set1_epi8(0x58)));
+            __m256i gaps = _mm256_or_si256(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(',')),
+                                           _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('.')));
+            __m256i ok = _mm256_or_si256(_mm256_or_si256(space, control), _mm256_andnot_si256(gaps, range));
+            bad |= uint64_t{~static_cast<uint32_t>(_mm256_movemask_epi8(ok))} << i;
+            opens |= uint64_t{static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('('))))} << i;
+            closes |= uint64_t{static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(')'))))} << i;
+        }
+        if (bad || !balance_group(opens, closes, depth)) {
+            return false;
+        }
+    }
+    return validate_bytes(p, end, depth);
+}
+
+__attribute__((target("avx512bw")))
+bool validate_avx512(const char* program, size_t length) {
+    const char* p = program;
+    const char* end = program + length;
+    int64_t depth = 0;
+    for (; end - p >= 64; p += 64) {
+        __m512i bytes = _mm512_loadu_si512(p);
+        __mmask64 space = _mm512_cmpeq_epi8_mask(bytes, _mm512_set1_epi8(' '));
+        __mmask64 control = _mm512_cmplt_epi8_mask(_mm512_add_epi8(bytes, _mm512_set1_epi8(0x77)), _mm512_set1_epi8(-123));
+        __mmask64 range = _mm512_cmplt_epi8_mask(_mm512_add_epi8(bytes, _mm512_set1_epi8(0x58)), _mm512_set1_epi8(-110));
+        __mmask64 gaps = _mm512_cmpeq_epi8_mask(bytes, _mm512_set1_epi8(',')) | _mm512_cmpeq_epi8_mask(bytes, _mm512_set1_epi8('.'));
+        uint64_t bad = ~(space | control | (range & ~gaps));
+        uint64_t opens = _mm512_cmpeq_epi8_mask(bytes, _mm512_set1_epi8('('));
+        uint64_t closes = _mm512_cmpeq_epi8_mask(bytes, _mm512_set1_epi8(')'));
+        if (bad || !balance_group(opens, closes, depth)) {
+            return false;
+        }
+    }
+    return validate_bytes(p, end, depth);
+}
+#endif
+
+// Whether every byte of the program is in the grammar and its parentheses
+// balance, with the widest vectors the CPU has.
+bool validate_structure(const char* program, size_t length) {
+    using Validator = bool (*)(const char*, size_t);
+#if defined(PARSER_X86_VALIDATION)
+    static const Validator validate = __builtin_cpu_supports("avx512bw") ? validate_avx512
+                                    : __builtin_cpu_supports("avx2") ? validate_avx2
+                                    : validate_sse2;
+#else
+    static const Validator validate = validate_scalar;
+#endif
+    return validate(program, length);
+}
+
+struct ParserWithValidation : IParser {
+    using IParser::execute;
+
+    int64_t execute(const char* program, size_t length) const final {
+        if (!validate_structure(program, length)) {
+            return execute_program<ResultPolicy>(program, length);
+        }
+        return execute_program<ExceptionPolicy>(program, length);
+    }
+
+    int64_t execute(const char* program, size_t length, ErrorKind* error) const final {
+        if (!validate_structure(program, length)) {
+            return execute_program<ResultPolicy>(program, length, error);
+        }
+        return execute_program<ExceptionPolicy>(program, length, error);
+    }
+
+    std::string execute_big(const char* program, size_t length) const final {
+        if (!validate_structure(program, length)) {
+            return execute_big_program<ResultPolicy>(program, length);
+        }
+        return execute_big_program<ExceptionPolicy>(program, length);
+    }
+
+    // Programs with variables have letters in them, so they are compiled
+    // without the check, by the engine that doesn't throw.
+    std::unique_ptr<IProgram> compile(const char* program, size_t length,
+                                      const std::vector<std::string>& names) const final {
+        return std::unique_ptr<IProgram>{new CompiledProgram<ResultPolicy>{program, length, names}};
+    }
+};
+
+std::unique_ptr<IParser> make_parser_with_validation() {
+    return std::unique_ptr<IParser>{new ParserWithValidation};
+}
+
+// Follows the grammar with a stack of what every open level waits for: a ')',
+// or one or two more operands. An operand completes every operator above it
+// that was waiting for its last one.
+bool nesting_depth_within(const char* program, size_t length, size_t max_depth) {
+    enum Wait : unsigned char { CloseParen, OneOperand, TwoOperands };
+    std::vector<unsigned char> levels;
+    const char* end = program + length;
+    for (const char* p = program; p != end; ++p) {
+        unsigned char c = char_classes[static_cast<unsigned char>(*p)];
+        if (c & CharSpace) {
+            continue;
+        }
+        bool operand = false;
+        if (c & CharOpenParen) {
+            levels.push_back(CloseParen);
+        } else if (c & CharOperator) {
+            levels.push_back(TwoOperands);
+        } else if (c & (CharDigit | CharLetter)) {
+            while (p + 1 != end && (char_classes[static_cast<unsigned char>(p[1])] & (CharDigit | CharLetter))) {
+                ++p;
+            }
+            operand = true;
+        } else if ((c & CharCloseParen) && !levels.empty() && levels.back() == CloseParen) {
+            levels.pop_back();
+            operand = true;
+        } else {
+            return true;
+        }
+        if (levels.size() > max_depth) {
+            return false;
+        }
+        if (operand) {
+            while (!levels.empty() && levels.back() != CloseParen) {
+                if (levels.back() == TwoOperands) {
+                    levels.back() = OneOperand;
+                    break;
+                }
+                levels.pop_back();
+            }
+            if (levels.empty()) {
+                return true;
+            }
+        }
+    }
+    return true;
+}
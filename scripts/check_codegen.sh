@@ -0,0 +1,59 @@
+#!/bin/sh
+# Usage: check_codegen.sh REV [COMPILER...]
+#
+# Checks that the engines compile to the same machine code in the working
+# tree as at git revision REV, e.g. that instrumentation which is compiled out
+# by default (PARSER_COUNTERS) really leaves nothing behind. Every engine
+# object is built from both trees with every COMPILER (c++ by default), as
+# C++11 and C++20 at -O2 and -O3. The disassembly and relocations of the two
+# must match, which also makes the sizes of their code sections equal; the
+# sizes are printed for the record. Every combination is checked, and the
+# script exits non-zero at the end if any of them differed.
+
+set -e
+
+if [ $# -lt 1 ]; then
+    echo "Usage: $0 REV [COMPILER...]" >&2
+    exit 1
+fi
+
+rev=$1
+shift
+[ $# -gt 0 ] || set -- c++
+
+root=$(git rev-parse --show-toplevel)
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+mkdir "$work/base"
+git -C "$root" archive "$rev" | tar -x -C "$work/base"
+
+text() {
+    size -A "$1" | awk '$1 ~ /^\.text/ { bytes += $2 } END { print bytes + 0 }'
+}
+
+engines="parser_with_exceptions parser_with_results"
+status=0
+for compiler in "$@"; do
+    for std in 11 20; do
+        for opt in O2 O3; do
+            for engine in $engines; do
+                flags="-std=c++$std -$opt -c"
+                "$compiler" $flags -o "$work/base.o" "$work/base/$engine.cpp"
+                "$compiler" $flags -o "$work/tree.o" "$root/$engine.cpp"
+                # The first lines name the file.
+                objdump -d -r "$work/base.o" | tail -n +3 > "$work/base.s"
+                objdump -d -r "$work/tree.o" | tail -n +3 > "$work/tree.s"
+                if cmp -s "$work/base.s" "$work/tree.s"; then
+                    result=same
+                else
+                    result=DIFFERENT
+                    status=1
+                fi
+                printf '%s c++%s -%s %s: .text %s -> %s bytes, %s\n' "$compiler" "$std" "$opt" "$engine" \
+                    "$(text "$work/base.o")" "$(text "$work/tree.o")" "$result"
+            done
+        done
+    done
+done
+exit $status
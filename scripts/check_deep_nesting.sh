@@ -0,0 +1,60 @@
+#!/bin/sh
+# Usage: check_deep_nesting.sh [BUILD_DIR]
+#
+# Checks that parser-server and parser-ingest turn away a program nested far
+# more deeply than max_nesting_depth (1000000 '(' and a 1), which would
+# overflow the stack of any engine, instead of crashing. The server from
+# BUILD_DIR (the current directory by default) gets the program from
+# parser-load once per engine, which must count it as an error, and then
+# input.ok, which must still be answered. parser-ingest gets a corpus with
+# the program between two others, and must count it as the one error.
+# Exits non-zero on the first failure.
+
+set -e
+
+build=${1:-.}
+root=$(git rev-parse --show-toplevel)
+work=$(mktemp -d)
+server=""
+cleanup() {
+    if [ -n "$server" ]; then
+        kill "$server" 2> /dev/null || true
+        wait "$server" 2> /dev/null || true
+    fi
+    rm -rf "$work"
+}
+trap cleanup EXIT
+
+awk 'BEGIN { for (i = 0; i < 1000000; i++) printf "("; print "1" }' > "$work/deep"
+
+"$build/parser-server" "$work/socket" --threads 1 2> /dev/null &
+server=$!
+for i in 1 2 3 4 5 6 7 8 9 10; do
+    [ -S "$work/socket" ] && break
+    sleep 0.1
+done
+
+for engine in results exceptions; do
+    if ! "$build/parser-load" "$work/socket" --engine "$engine" --requests 1 --input "$work/deep" | grep -q ' errors=1 '; then
+        echo "parser-server doesn't answer a program nested 1000000 deep with an error, with the $engine engine." >&2
+        exit 1
+    fi
+    if ! "$build/parser-load" "$work/socket" --engine "$engine" --requests 1 --input "$root/input.ok" | grep -q ' errors=0 '; then
+        echo "parser-server doesn't answer after a program nested 1000000 deep, with the $engine engine." >&2
+        exit 1
+    fi
+done
+echo "parser-server: a program nested 1000000 deep is an error, and the server goes on."
+
+{
+    cat "$root/input.ok"
+    cat "$work/deep"
+    cat "$root/input.ok"
+} > "$work/corpus"
+for engine in results exceptions; do
+    if ! "$build/parser-ingest" "$work/corpus" --engine "$engine" | grep -q ' programs=3 .* errors=1 '; then
+        echo "parser-ingest doesn't count a program nested 1000000 deep as an error, with the $engine engine." >&2
+        exit 1
+    fi
+done
+echo "parser-ingest: a program nested 1000000 deep is an error, and the run goes on."
@@ -0,0 +1,153 @@
+#!/usr/bin/env python3
+"""Compares two results.jsonl files written by the benchmark binaries.
+
+For every benchmark present in both files, prints the change of the median
+time, and flags it as a regression when the candidate is slower than the
+baseline by more than --threshold percent and a one-sided Welch's t-test
+over the repetitions finds the slowdown significant at --alpha. Benchmarks
+with a single repetition on either side can only be judged by the threshold.
+
+Exits with status 1 if any benchmark regressed, so that it can gate a
+toolchain upgrade:
+
+    scripts/compare_results.py old/results.jsonl new/results.jsonl --compiler gcc12=gcc13
+
+--compiler renames a compiler of the baseline to one of the candidate, so
+that "gcc12-O3-cxx17" is compared with "gcc13-O3-cxx17". The other
+compilers in the files are compared with themselves, never pooled.
+"""
+
+import argparse
+import json
+import math
+import statistics
+import sys
+
+
+def load(path, renames):
+    """Samples by (compiler, benchmark), with the compilers renamed by
+    renames ("gcc12-O3-cxx17" -> "gcc13-O3-cxx17" for {"gcc12": "gcc13"})."""
+    results = {}
+    sources = {}
+    with open(path) as f:
+        for line in f:
+            line = line.strip()
+            if not line:
+                continue
+            record = json.loads(line)
+            compiler = record["compiler"]
+            name, dash, variant = compiler.partition("-")
+            renamed = renames.get(name, name) + dash + variant
+            key = (renamed, record["benchmark"])
+            if sources.setdefault(key, compiler) != compiler:
+                # Exit status 2, as for bad arguments, since 1 means a regression.
+                print("%s: %s and %s would both be compared as %s" % (path, sources[key], compiler, renamed),
+                      file=sys.stderr)
+                sys.exit(2)
+            samples = results.setdefault(key, [])
+            samples.extend(record["metrics"]["us"])
+    return results
+
+
+def compiler_rename(text):
+    old, equals, new = text.partition("=")
+    if not old or not equals or not new or "-" in old or "-" in new:
+        raise argparse.ArgumentTypeError("expected OLD=NEW, e.g. gcc12=gcc13")
+    return old, new
+
+
+def betacf(a, b, x):
+    """Continued fraction for the regularized incomplete beta function."""
+    tiny = 1e-300
+    qab, qap, qam = a + b, a + 1.0, a - 1.0
+    c, d = 1.0, 1.0 - qab * x / qap
+    d = 1.0 / (d if abs(d) > tiny else tiny)
+    h = d
+    for m in range(1, 300):
+        m2 = 2 * m
+        aa = m * (b - m) * x / ((qam + m2) * (a + m2))
+        d = 1.0 + aa * d
+        d = 1.0 / (d if abs(d) > tiny else tiny)
+        c = 1.0 + aa / c
+        c = c if abs(c) > tiny else tiny
+        h *= d * c
+        aa = -(a + m) * (qab + m) * x / ((a + m2) * (qap + m2))
+        d = 1.0 + aa * d
+        d = 1.0 / (d if abs(d) > tiny else tiny)
+        c = 1.0 + aa / c
+        c = c if abs(c) > tiny else tiny
+        delta = d * c
+        h *= delta
+        if abs(delta - 1.0) < 1e-12:
+            break
+    return h
+
+
+def betainc(a, b, x):
+    if x <= 0.0:
+        return 0.0
+    if x >= 1.0:
+        return 1.0
+    front = math.exp(math.lgamma(a + b) - math.lgamma(a) - math.lgamma(b)
+                     + a * math.log(x) + b * math.log(1.0 - x))
+    if x < (a + 1.0) / (a + b + 2.0):
+        return front * betacf(a, b, x) / a
+    return 1.0 - front * betacf(b, a, 1.0 - x) / b
+
+
+def welch_p_slower(baseline, candidate):
+    """One-sided p-value for 'candidate is slower than baseline'."""
+    n1, n2 = len(baseline), len(candidate)
+    v1, v2 = statistics.variance(baseline) / n1, statistics.variance(candidate) / n2
+    diff = statistics.mean(candidate) - statistics.mean(baseline)
+    if v1 + v2 == 0.0:
+        return 0.0 if diff > 0 else 1.0
+    t = diff / math.sqrt(v1 + v2)
+    df = (v1 + v2) ** 2 / (v1 ** 2 / (n1 - 1) + v2 ** 2 / (n2 - 1))
+    tail = 0.5 * betainc(df / 2.0, 0.5, df / (df + t * t))
+    return tail if t > 0 else 1.0 - tail
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("baseline")
+    parser.add_argument("candidate")
+    parser.add_argument("--threshold", type=float, default=5.0,
+                        help="slowdown in percent that counts as a regression (default: 5)")
+    parser.add_argument("--alpha", type=float, default=0.05,
+                        help="significance level of the t-test (default: 0.05)")
+    parser.add_argument("--compiler", metavar="OLD=NEW", type=compiler_rename, action="append", default=[],
+                        help="compare the baseline's compiler OLD with the candidate's NEW, "
+                             "e.g. gcc12=gcc13; may be repeated")
+    args = parser.parse_args()
+
+    baseline = load(args.baseline, dict(args.compiler))
+    candidate = load(args.candidate, {})
+
+    regressions = 0
+    for key in sorted(baseline.keys() & candidate.keys()):
+        old, new = baseline[key], candidate[key]
+        old_median, new_median = statistics.median(old), statistics.median(new)
+        change = 100.0 * (new_median - old_median) / old_median if old_median else 0.0
+        if len(old) > 1 and len(new) > 1:
+            p = welch_p_slower(old, new)
+            significant = p < args.alpha
+            p_text = "p=%.3f" % p
+        else:
+            significant = True
+            p_text = "p=n/a"
+        regressed = change > args.threshold and significant
+        regressions += regressed
+        print("%-24s %-44s %10.0fµs %10.0fµs %+7.1f%% %9s%s" % (
+            key[0], key[1], old_median, new_median, change, p_text,
+            "  REGRESSION" if regressed else ""))
+
+    for key in sorted(baseline.keys() ^ candidate.keys()):
+        side = "baseline" if key in baseline else "candidate"
+        print("%-24s %-44s only in %s" % (key[0], key[1], side))
+
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,38 @@
+#!/bin/sh
+# Usage: dispatch_report.sh [RESULTS]
+#
+# Splits the time of every engine in results.csv (by default) into parsing,
+# the cost of calling into another translation unit, and the cost of the
+# virtual call through IParser, from the three variants of each benchmark:
+#
+#   parser-ENGINE-CASE           through std::unique_ptr<IParser>
+#   parser-ENGINE-CASE-cross-tu  through the engine's C entry point
+#   parser-ENGINE-CASE-static    the grammar instantiated in main.cpp
+
+set -e
+
+awk -F ';' '
+    FNR == 1 { next }
+    {
+        name = $2
+        variant = "virtual"
+        if (sub(/-cross-tu$/, "", name)) variant = "cross-tu"
+        else if (sub(/-static$/, "", name)) variant = "static"
+        key = $1 ";" name
+        us[key ";" variant] = $3
+        if (!(key in seen)) { seen[key] = 1; keys[++n] = key }
+    }
+    END {
+        print "compiler;benchmark;total µs;parsing µs;cross-TU call µs;virtual dispatch µs"
+        for (i = 1; i <= n; ++i) {
+            key = keys[i]
+            if ((key ";static") in us && (key ";cross-tu") in us && (key ";virtual") in us) {
+                total = us[key ";virtual"]
+                parsing = us[key ";static"]
+                cross_tu = us[key ";cross-tu"] - parsing
+                dispatch = total - us[key ";cross-tu"]
+                printf "%s;%d;%d;%d;%d\n", key, total, parsing, cross_tu, dispatch
+            }
+        }
+    }
+' "${1:-results.csv}"
@@ -0,0 +1,140 @@
+#!/bin/sh
+# Usage: flamegraph.sh BINARY BENCHMARK [SECONDS] [OUT]
+#
+# Profiles one benchmark of BINARY, best the -profile build, which keeps the
+# frame pointers of every function, e.g.
+#
+#   scripts/flamegraph.sh ./exceptions-versus-results-gcc12-profile parser-exceptions-with-errors 10
+#
+# Only BENCHMARK runs, for SECONDS (10 by default), under perf record -g. The
+# stacks are folded into OUT.folded (OUT is BENCHMARK by default) and, with
+# flamegraph.pl (from Brendan Gregg's FlameGraph, in PATH or FLAMEGRAPH_DIR)
+# or inferno-flamegraph, drawn as OUT.svg. Last, it prints the share of the
+# samples spent in each function of the unwinder and the C++ runtime that
+# shows up: _Unwind_*, the personality routine, __cxa_*, and the search for
+# unwind tables (dl_iterate_phdr, _dl_find_object).
+#
+# The system's libraries are usually built without frame pointers, so the
+# caller of a function in them can be missing from a stack. CALL_GRAPH=dwarf
+# records the stacks with DWARF instead, which is slower but exact. Run it
+# where the benchmark finds its inputs (input.ok, input.err and input.div0).
+
+set -e
+
+if [ $# -lt 2 ]; then
+    echo "Usage: $0 BINARY BENCHMARK [SECONDS] [OUT]" >&2
+    exit 1
+fi
+
+binary=$1
+benchmark=$2
+seconds=${3:-10}
+out=${4:-$benchmark}
+call_graph=${CALL_GRAPH:-fp}
+
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+# Batches of 10000 calls, so that timing them costs nothing.
+perf record --call-graph "$call_graph" -o "$out.data" -- \
+    "$binary" 10000 --only "$benchmark" --seconds "$seconds" --no-fork > "$work/output"
+cat "$work/output"
+if [ ! -s "$work/output" ]; then
+    echo "$binary has no benchmark $benchmark." >&2
+    exit 1
+fi
+
+perf script -i "$out.data" > "$work/perf.script"
+collapse=""
+for dir in "$FLAMEGRAPH_DIR" $(echo "$PATH" | tr ':' ' '); do
+    if [ -n "$dir" ] && [ -x "$dir/stackcollapse-perf.pl" ]; then
+        collapse="$dir/stackcollapse-perf.pl"
+        break
+    fi
+done
+if [ -n "$collapse" ]; then
+    "$collapse" "$work/perf.script" > "$out.folded"
+else
+    # The same as stackcollapse-perf.pl does: a sample is a line with the
+    # command, then its frames from the leaf up, as "address symbol+offset
+    # (library)", and a blank line. Its folded stack is the command and the
+    # symbols from the root down, separated by ';', and a count.
+    awk '
+        function flush(    stack, i) {
+            if (comm != "") {
+                stack = comm
+                for (i = depth; i >= 1; i--) {
+                    stack = stack ";" frames[i]
+                }
+                counts[stack]++
+            }
+            comm = ""
+            depth = 0
+        }
+        /^$/ { flush(); next }
+        /^[^ \t]/ { flush(); comm = $1; next }
+        {
+            frame = $0
+            sub(/^[ \t]*[0-9a-f]+ /, "", frame)
+            sub(/ \([^()]*\)$/, "", frame)
+            sub(/\+0x[0-9a-f]+$/, "", frame)
+            gsub(/;/, ":", frame)
+            frames[++depth] = frame
+        }
+        END {
+            flush()
+            for (stack in counts) {
+                print stack, counts[stack]
+            }
+        }
+    ' "$work/perf.script" | sort > "$out.folded"
+fi
+
+render=""
+for dir in "$FLAMEGRAPH_DIR" $(echo "$PATH" | tr ':' ' '); do
+    if [ -n "$dir" ] && [ -x "$dir/flamegraph.pl" ]; then
+        render="$dir/flamegraph.pl"
+        break
+    fi
+done
+if [ -z "$render" ] && command -v inferno-flamegraph > /dev/null; then
+    render=inferno-flamegraph
+fi
+if [ -n "$render" ]; then
+    "$render" --title "$benchmark" "$out.folded" > "$out.svg"
+    echo "Wrote $out.folded and $out.svg."
+else
+    echo "Wrote $out.folded (no flamegraph.pl or inferno-flamegraph to draw it)."
+fi
+
+# A function counts once per sample that it is anywhere in the stack of.
+awk '
+    {
+        n = $NF
+        total += n
+        stack = $0
+        sub(/ [0-9]+$/, "", stack)
+        frames = split(stack, frame, ";")
+        split("", seen)
+        any = 0
+        for (i = 1; i <= frames; i++) {
+            f = frame[i]
+            if (f ~ /^(_Unwind_|__gxx_personality|__cxa_|uw_|execute_cfa_program|search_object|linear_search_fdes|dl_iterate_phdr|_dl_find_object)/ && !(f in seen)) {
+                seen[f] = 1
+                samples[f] += n
+                any = 1
+            }
+        }
+        unwinding += any * n
+    }
+    END {
+        if (total == 0) {
+            exit
+        }
+        printf "%6.2f%%  of %d samples in the unwinder and the C++ runtime, of which:\n", 100 * unwinding / total, total
+        fflush()
+        for (f in samples) {
+            printf "%6.2f%%  %s\n", 100 * samples[f] / total, f | "sort -rn"
+        }
+    }
+' "$out.folded"
@@ -0,0 +1,49 @@
+#!/bin/sh
+# Usage: merge_sizes.sh [RESULTS] [SIZES]
+#
+# Adds the section sizes recorded by size_report.sh to every row of the
+# benchmark results (results.csv and sizes.csv by default), so that time and
+# size can be plotted together. Each row gets the sizes of the whole binary
+# for that compiler, followed by the sizes of the object file of the engine
+# that the benchmark exercised ("parser-results-..." -> parser_with_results,
+# "parser-no-checks-..." -> parser_with_no_checks). Benchmarks without an
+# engine object, such as parser-constexpr-* (evaluated by the compiler), get
+# empty engine columns.
+
+set -e
+
+results=${1:-results.csv}
+sizes=${2:-sizes.csv}
+
+awk -F ';' -v OFS=';' '
+    BEGIN {
+        # Benchmark prefix (after "parser-") and the object file of its engine.
+        engines = split("exceptions results coroutines jit simd threads validation no-checks abort", prefixes, " ")
+        split("exceptions results coroutines jit simd threads validation no_checks abort", objects, " ")
+    }
+    FNR == 1 { next }
+    NR == FNR { bytes[$1 ";" $2 ";" $3] = $4; if ($2 ~ /^exceptions-versus-results-/) binary[$1] = $2; next }
+    {
+        if (NF > 3) NF = 3
+        engine = ""
+        for (i = 1; i <= engines; ++i) {
+            if (index($2, "parser-" prefixes[i] "-") == 1) {
+                engine = "parser_with_" objects[i]
+                break
+            }
+        }
+        row = $0
+        n = split(".text .eh_frame .eh_frame_hdr .gcc_except_table", sections, " ")
+        for (i = 1; i <= n; ++i) row = row OFS bytes[$1 ";" binary[$1] ";" sections[i]]
+        for (i = 1; i <= n; ++i) {
+            if (sections[i] != ".eh_frame_hdr") row = row OFS (engine == "" ? "" : bytes[$1 ";" engine ";" sections[i]])
+        }
+        print row
+    }
+' "$sizes" "$results" > "$results.tmp"
+
+{
+    echo "compiler;benchmark;µs;binary .text;binary .eh_frame;binary .eh_frame_hdr;binary .gcc_except_table;engine .text;engine .eh_frame;engine .gcc_except_table"
+    cat "$results.tmp"
+} > "$results"
+rm -f "$results.tmp"
@@ -0,0 +1,50 @@
+#!/bin/sh
+# Usage: size_report.sh COMPILER BINARY [OBJECT...]
+#
+# Appends the size of the code and unwind sections of BINARY and of every
+# OBJECT to sizes.csv, and the size of every function they define to
+# functions.csv. Sections that a compiler splits up (.text.unlikely,
+# .text._Z..., .gcc_except_table._Z...) are summed under their base name.
+
+set -e
+
+if [ $# -lt 2 ]; then
+    echo "Usage: $0 COMPILER BINARY [OBJECT...]" >&2
+    exit 1
+fi
+
+compiler=$1
+shift
+
+[ -f sizes.csv ] || echo "compiler;target;section;bytes" > sizes.csv
+[ -f functions.csv ] || echo "compiler;target;function;bytes" > functions.csv
+
+for file in "$@"; do
+    target=$(basename "$file" .o)
+    target=${target%.cpp}
+
+    # Objects holding only LTO bitcode have no machine code to measure.
+    if ! size -A "$file" > /dev/null 2>&1; then
+        echo "$0: skipping $file, not an object file" >&2
+        continue
+    fi
+
+    size -A "$file" | awk -v compiler="$compiler" -v target="$target" '
+        $1 ~ /^\.text/             { bytes[".text"] += $2 }
+        $1 == ".eh_frame"          { bytes[".eh_frame"] += $2 }
+        $1 == ".eh_frame_hdr"      { bytes[".eh_frame_hdr"] += $2 }
+        $1 ~ /^\.gcc_except_table/ { bytes[".gcc_except_table"] += $2 }
+        END {
+            n = split(".text .eh_frame .eh_frame_hdr .gcc_except_table", sections, " ")
+            for (i = 1; i <= n; ++i) {
+                printf "%s;%s;%s;%d\n", compiler, target, sections[i], bytes[sections[i]]
+            }
+        }' >> sizes.csv
+
+    nm -C -S -t d --size-sort "$file" | awk -v compiler="$compiler" -v target="$target" '
+        $3 ~ /^[tTwW]$/ {
+            name = $4
+            for (i = 5; i <= NF; ++i) name = name " " $i
+            printf "%s;%s;%s;%d\n", compiler, target, name, $2 + 0
+        }' >> functions.csv
+done
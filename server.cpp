@@ -0,0 +1,347 @@
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "parser.hpp"
+#include "server_protocol.hpp"
+
+// parser-server: evaluates programs sent over a Unix domain socket (see
+// server_protocol.hpp), for running the calculator as a sidecar.
+//
+// There is one reactor per core, each a thread pinned to its core with its
+// own epoll instance and its own engines. SO_REUSEPORT doesn't spread Unix
+// domain sockets over listeners, so the reactors share the one listening
+// socket instead, registered with EPOLLEXCLUSIVE: the kernel wakes a single
+// reactor per incoming connection, which then keeps the connection for its
+// lifetime. Each wakeup reads up to read_chunk bytes of a connection,
+// evaluates every complete request in them, and writes the responses with a
+// single write.
+
+const size_t read_chunk = 64 * 1024;
+
+// Stands in for "no error", since engines only store an ErrorKind on errors.
+const ErrorKind no_error = static_cast<ErrorKind>(-1);
+
+struct Connection {
+    std::string in;   // received, up to the last incomplete request
+    std::string out;  // responses not written yet
+    size_t written = 0;
+    bool blocked = false;  // waiting to write the rest of out
+};
+
+const size_t engine_count = 3;
+
+class Reactor {
+public:
+    Reactor(int listener, int stop_event) : listener(listener), stop_event(stop_event) {
+        engines[static_cast<size_t>(Engine::Exceptions)] = make_parser_with_exceptions();
+        engines[static_cast<size_t>(Engine::Results)] = make_parser_with_results();
+#if defined(PARSER_COROUTINES)
+        engines[static_cast<size_t>(Engine::Coroutines)] = make_parser_with_coroutines();
+#endif
+    }
+
+    ~Reactor() {
+        for (auto& connection : connections) {
+            ::close(connection.first);
+        }
+        if (epoll >= 0) {
+            ::close(epoll);
+        }
+    }
+
+    bool run() {
+        epoll = ::epoll_create1(EPOLL_CLOEXEC);
+        if (epoll < 0 || !watch(listener, EPOLLIN | EPOLLEXCLUSIVE) || !watch(stop_event, EPOLLIN)) {
+            std::perror("epoll");
+            return false;
+        }
+
+        epoll_event events[64];
+        for (;;) {
+            int count = ::epoll_wait(epoll, events, 64, -1);
+            if (count < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                std::perror("epoll_wait");
+                return false;
+            }
+            for (int i = 0; i < count; ++i) {
+                int fd = events[i].data.fd;
+                if (fd == stop_event) {
+                    return true;
+                } else if (fd == listener) {
+                    accept_connection();
+                } else if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                    close_connection(fd);
+                } else if (events[i].events & EPOLLOUT) {
+                    flush(fd);
+                } else {
+                    receive(fd);
+                }
+            }
+        }
+    }
+
+private:
+    int listener;
+    int stop_event;
+    int epoll = -1;
+    std::unique_ptr<IParser> engines[engine_count];
+    std::unordered_map<int, Connection> connections;
+    std::vector<char> buffer = std::vector<char>(read_chunk);
+
+    bool watch(int fd, uint32_t events) {
+        epoll_event event{};
+        event.events = events;
+        event.data.fd = fd;
+        return ::epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &event) == 0;
+    }
+
+    void rewatch(int fd, uint32_t events) {
+        epoll_event event{};
+        event.events = events;
+        event.data.fd = fd;
+        ::epoll_ctl(epoll, EPOLL_CTL_MOD, fd, &event);
+    }
+
+    // One connection per wakeup, so that a burst of them is spread over the
+    // reactors.
+    void accept_connection() {
+        int fd = ::accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            return;
+        }
+        if (!watch(fd, EPOLLIN)) {
+            ::close(fd);
+            return;
+        }
+        connections[fd];
+    }
+
+    void close_connection(int fd) {
+        ::close(fd);
+        connections.erase(fd);
+    }
+
+    // One read of at most read_chunk bytes per wakeup, so that a client that
+    // keeps sending can't keep the reactor from its other connections, nor
+    // pile up unanswered requests in memory. Whatever is left in the socket
+    // wakes epoll again (it is level-triggered).
+    void receive(int fd) {
+        Connection& connection = connections[fd];
+        ssize_t n;
+        do {
+            n = ::read(fd, buffer.data(), buffer.size());
+        } while (n < 0 && errno == EINTR);
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return;
+        }
+        if (n <= 0) {
+            close_connection(fd);
+            return;
+        }
+        connection.in.append(buffer.data(), static_cast<size_t>(n));
+
+        if (!evaluate(connection)) {
+            close_connection(fd);
+            return;
+        }
+        flush(fd);
+    }
+
+    // Answers every complete request in the input, leaving the rest for the
+    // next read.
+    bool evaluate(Connection& connection) {
+        const std::string& in = connection.in;
+        size_t at = 0;
+        while (in.size() - at >= request_header_size) {
+            uint32_t length = load_u32(&in[at]);
+            size_t engine = static_cast<unsigned char>(in[at + 4]);
+            if (length > max_program_length || engine >= engine_count || !engines[engine]) {
+                return false;
+            }
+            if (in.size() - at - request_header_size < length) {
+                break;
+            }
+
+            // The engines recurse, so the nesting of a program is checked
+            // before it can overflow the reactor's stack.
+            const char* program = &in[at + request_header_size];
+            int64_t value = 0;
+            uint8_t status = status_too_deep;
+            if (nesting_depth_within(program, length, max_nesting_depth)) {
+                ErrorKind error = no_error;
+                value = engines[engine]->execute(program, length, &error);
+                status = error == no_error ? 0 : static_cast<uint8_t>(static_cast<int>(error) + 1);
+            }
+            append_response(connection.out, value, status);
+            at += request_header_size + length;
+        }
+        connection.in.erase(0, at);
+        return true;
+    }
+
+    // Writes what it can, and waits for the socket to be writable (not
+    // reading any more requests meanwhile) if that isn't everything.
+    void flush(int fd) {
+        Connection& connection = connections[fd];
+        while (connection.written < connection.out.size()) {
+            ssize_t n = ::send(fd, connection.out.data() + connection.written, connection.out.size() - connection.written,
+                               MSG_NOSIGNAL);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    if (!connection.blocked) {
+                        connection.blocked = true;
+                        rewatch(fd, EPOLLOUT);
+                    }
+                    return;
+                }
+                close_connection(fd);
+                return;
+            }
+            connection.written += static_cast<size_t>(n);
+        }
+        connection.out.clear();
+        connection.written = 0;
+        if (connection.blocked) {
+            connection.blocked = false;
+            rewatch(fd, EPOLLIN);
+        }
+    }
+};
+
+void pin_to_cpu(int cpu) {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    ::pthread_setaffinity_np(::pthread_self(), sizeof(cpus), &cpus);
+}
+
+int listen_on(const char* path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (std::strlen(path) >= sizeof(address.sun_path)) {
+        std::cerr << "Socket path too long: " << path << '\n';
+        return -1;
+    }
+    std::strcpy(address.sun_path, path);
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        std::perror("socket");
+        return -1;
+    }
+    ::unlink(path);
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || ::listen(fd, SOMAXCONN) != 0) {
+        std::perror(path);
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool parse_number(const char* arg, size_t& out) {
+    std::stringstream ss;
+    ss << arg;
+    return static_cast<bool>(ss >> out);
+}
+
+int main(int argc, char const *argv[])
+{
+    const char* path = nullptr;
+    size_t threads = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc && parse_number(argv[i + 1], threads) && threads > 0) {
+            ++i;
+        } else if (argv[i][0] != '-' && !path) {
+            path = argv[i];
+        } else {
+            path = nullptr;
+            break;
+        }
+    }
+    if (!path) {
+        std::cerr << "Usage: " << argv[0] << " SOCKET [--threads N]\n";
+        return 1;
+    }
+
+    // One reactor per CPU we may run on, unless asked otherwise.
+    cpu_set_t allowed;
+    std::vector<int> cpus;
+    if (::sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &allowed)) {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+    if (threads == 0) {
+        threads = std::max<size_t>(1, cpus.size());
+    }
+
+    // INT and TERM are taken by sigwait below, in the main thread only.
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    ::pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    int listener = listen_on(path);
+    if (listener < 0) {
+        return 1;
+    }
+    int stop_event = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (stop_event < 0) {
+        std::perror("eventfd");
+        return 1;
+    }
+
+    std::vector<std::thread> reactors;
+    for (size_t i = 0; i < threads; ++i) {
+        int cpu = threads <= cpus.size() ? cpus[i] : -1;
+        reactors.emplace_back([=]() {
+            if (cpu >= 0) {
+                pin_to_cpu(cpu);
+            }
+            Reactor reactor{listener, stop_event};
+            if (!reactor.run()) {
+                std::exit(1);
+            }
+        });
+    }
+    std::cerr << "Listening on " << path << " with " << threads << " reactors.\n";
+
+    int signal = 0;
+    ::sigwait(&signals, &signal);
+    uint64_t one = 1;
+    if (::write(stop_event, &one, sizeof(one)) != sizeof(one)) {
+        std::perror("eventfd");
+    }
+    for (std::thread& reactor : reactors) {
+        reactor.join();
+    }
+    ::close(listener);
+    ::unlink(path);
+    return 0;
+}
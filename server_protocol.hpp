@@ -0,0 +1,93 @@
+#pragma once
+#ifndef SERVER_PROTOCOL_HPP
+#define SERVER_PROTOCOL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <string>
+
+// The protocol of parser-server (server.cpp) over a Unix domain stream
+// socket. A connection carries any number of requests, which are answered in
+// order, so a client may send the next ones before the answers arrive.
+//
+// A request is a 5-byte header followed by the program:
+//
+//   uint32_t length       little-endian, the length of the program
+//   uint8_t engine        which engine evaluates it (see Engine)
+//   char program[length]
+//
+// A response is 9 bytes:
+//
+//   int64_t value         little-endian, 0 if the program has errors
+//   uint8_t status        0, one more than the ErrorKind, or status_too_deep
+//
+// A program nested more deeply than max_nesting_depth (see parser.hpp) isn't
+// evaluated, since it could overflow the stack of the server, and is
+// answered with status_too_deep.
+//
+// The server closes the connection on a request for an engine it doesn't
+// have, or of more than max_program_length bytes.
+
+enum class Engine : uint8_t {
+    Exceptions,
+    Results,
+    Coroutines,
+};
+
+const size_t request_header_size = 5;
+const size_t response_size = 9;
+const uint32_t max_program_length = 16 << 20;
+const uint8_t status_too_deep = 255;
+
+inline uint32_t load_u32(const char* p) {
+    const unsigned char* b = reinterpret_cast<const unsigned char*>(p);
+    return uint32_t{b[0]} | uint32_t{b[1]} << 8 | uint32_t{b[2]} << 16 | uint32_t{b[3]} << 24;
+}
+
+inline uint64_t load_u64(const char* p) {
+    return uint64_t{load_u32(p)} | uint64_t{load_u32(p + 4)} << 32;
+}
+
+inline void append_u32(std::string& out, uint32_t v) {
+    char bytes[4] = {char(v), char(v >> 8), char(v >> 16), char(v >> 24)};
+    out.append(bytes, 4);
+}
+
+inline void append_u64(std::string& out, uint64_t v) {
+    append_u32(out, static_cast<uint32_t>(v));
+    append_u32(out, static_cast<uint32_t>(v >> 32));
+}
+
+inline void append_request(std::string& out, Engine engine, const char* program, uint32_t length) {
+    append_u32(out, length);
+    out += static_cast<char>(engine);
+    out.append(program, length);
+}
+
+inline void append_response(std::string& out, int64_t value, uint8_t status) {
+    append_u64(out, static_cast<uint64_t>(value));
+    out += static_cast<char>(status);
+}
+
+inline const char* engine_name(Engine engine) {
+    switch (engine) {
+        case Engine::Exceptions: return "exceptions";
+        case Engine::Results: return "results";
+        case Engine::Coroutines: return "coroutines";
+        default: return "unknown";
+    }
+}
+
+inline bool parse_engine(const char* name, Engine& engine) {
+    for (Engine e : {Engine::Exceptions, Engine::Results, Engine::Coroutines}) {
+        if (std::strcmp(name, engine_name(e)) == 0) {
+            engine = e;
+            return true;
+        }
+    }
+    return false;
+}
+
+#endif // SERVER_PROTOCOL_HPP